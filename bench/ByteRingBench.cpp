@@ -0,0 +1,64 @@
+#include "../src/utils/ByteRing.cpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/*
+
+    Consumer cost of SPMC_Queue (one 128 byte Block per message) against ByteRing (2-byte length
+    plus the message) on the order flow mix of wire sizes: A 36, D 19, E 31, X 23, U 35.
+
+    Each round the producer stages a window of messages that fits in both rings, publishes, and a
+    reader drains it, so the numbers are the copy and cache traffic of the consumer alone.
+
+    usage: ByteRingBench [messages] [window]
+
+*/
+
+static constexpr uint16_t MIX[] = {36, 19, 36, 19, 31, 23, 35, 19, 36, 19};
+
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv) {
+    const uint64_t messages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20'000'000;
+    const size_t window = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 16384;
+
+    SPMC_Queue queue(32768);
+    ByteRing ring(1 << 21);
+    SPMC_Reader queueReader(queue);
+    ByteRingReader ringReader(ring);
+    std::vector<uint8_t> scratch(65536);
+    uint8_t wire[64] = {'D'};
+
+    double queueNs = 0, ringNs = 0;
+    uint64_t checksumQueue = 0, checksumRing = 0;
+
+    for (uint64_t done = 0; done < messages; done += window) {
+        for (size_t i = 0; i < window; ++i) {
+            const uint16_t len = MIX[(done + i) % std::size(MIX)];
+            queue.Stage(len, [&](uint8_t* dst) { std::memcpy(dst, wire, len); });
+            ring.Stage(len, [&](uint8_t* dst) { std::memcpy(dst, wire, len); });
+        }
+        queue.Publish();
+        ring.Publish();
+
+        auto begin = Clock::now();
+        PayloadSize size;
+        while (queueReader.Read(scratch.data(), size) == ReadStatus::Ok) checksumQueue += size;
+        auto middle = Clock::now();
+        uint16_t length;
+        while (ringReader.Read(scratch.data(), scratch.size(), length) == ReadStatus::Ok) checksumRing += length;
+        auto end = Clock::now();
+
+        queueNs += std::chrono::duration<double, std::nano>(middle - begin).count();
+        ringNs += std::chrono::duration<double, std::nano>(end - middle).count();
+    }
+
+    const uint64_t total = (messages + window - 1) / window * window;
+    std::printf("%-10s %12s %14s %12s\n", "ring", "ns/msg", "bytes/msg", "msgs/line");
+    std::printf("%-10s %12.2f %14.1f %12.2f\n", "SPMC_Queue", queueNs / total, double(sizeof(Block)), 64.0 / sizeof(Block));
+    std::printf("%-10s %12.2f %14.1f %12.2f\n", "ByteRing", ringNs / total, double(ring.head()) / total, 64.0 * total / ring.head());
+    if (checksumQueue != checksumRing) std::printf("checksum mismatch %lu %lu\n", checksumQueue, checksumRing);
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "../src/utils/ConsumerGroup.cpp"
+#include "../src/utils/TscClock.cpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/*
+
+    Work sharing throughput of a ConsumerGroup on a Lossless queue.
+
+    Every message costs workNs of busy work (enrichment, journaling), so one consumer tops out at
+    1e9 / workNs messages per second. A group of k members should get close to k times that, as
+    long as there are cores for them. A broadcast SPMC_Reader runs alongside as a later stage
+    behind the group's completion barrier.
+
+    usage: GroupBench [messages] [workNs] [batch]
+
+*/
+
+int main(int argc, char** argv) {
+    const uint64_t messages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2'000'000;
+    const uint64_t workNs = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200;
+    const size_t batch = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : GroupMember::DEFAULT_BATCH;
+
+    TscClock::calibrate();
+    const uint64_t workTicks = TscClock::toTicks(workNs);
+
+    std::printf("%8s %12s %12s %10s\n", "members", "Mmsg/s", "batches", "errors");
+    for (size_t members : {1, 2, 4, 8}) {
+        SPMC_Queue queue(8192, QueueMode::Lossless, members + 1);
+        ConsumerGroup group(queue);
+        std::atomic<size_t> ready{0};
+        std::atomic<uint64_t> handled{0}, batches{0}, errors{0};
+
+        std::vector<std::thread> threads;
+        for (size_t m = 0; m < members; ++m) {
+            threads.emplace_back([&] {
+                GroupMember member(group, batch);
+                std::vector<QueueMessage> out(batch);
+                ready.fetch_add(1);
+
+                uint64_t n = 0;
+                while (group.completed() < messages) {
+                    auto got = member.Next(out);
+                    if (got.empty()) {
+                        member.Wait();
+                        continue;
+                    }
+                    for (size_t i = 0; i < got.size(); ++i) {
+                        uint64_t seq;
+                        std::memcpy(&seq, got[i].payload, sizeof(seq));
+                        if (seq != member.batchStart() + i) errors.fetch_add(1);
+                        const uint64_t until = TscClock::now() + workTicks;
+                        while (TscClock::now() < until) _mm_pause();
+                    }
+                    n += got.size();
+                }
+                handled.fetch_add(n);
+                batches.fetch_add(member.batches());
+            });
+        }
+
+        std::thread later([&] {
+            SPMC_Reader reader(queue);
+            reader.setBarrier(&group);
+            std::array<uint8_t, 64> scratch;
+            PayloadSize size;
+            ready.fetch_add(1);
+            while (reader.position() < messages) {
+                if (reader.Read(scratch.data(), size) != ReadStatus::Ok) reader.Wait();
+            }
+        });
+
+        while (ready.load() < members + 1) std::this_thread::yield();
+
+        const auto begin = std::chrono::steady_clock::now();
+        for (uint64_t seq = 0; seq < messages; ++seq) {
+            queue.Write(sizeof(seq), [seq](uint8_t* data) { std::memcpy(data, &seq, sizeof(seq)); });
+        }
+        for (auto& t : threads) t.join();
+        later.join();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        if (handled.load() != messages) errors.fetch_add(1);
+        std::printf("%8zu %12.2f %12lu %10lu\n", members, messages / seconds / 1e6, batches.load(), errors.load());
+    }
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include "../src/utils/SpmcRingBuffer.cpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+/*
+
+    SPMC_Queue throughput in Overwrite and Lossless mode, one message at a time and batched.
+
+    One producer publishes N 36 byte messages (an AddOrder) carrying their sequence number, each
+    consumer checks what it gets. With batch > 1 the producer stages batch messages per Publish
+    and consumers use ReadBatch. Reports producer and consumer rates, messages lost to laps in
+    Overwrite mode and producer stalls in Lossless mode. Every case runs on a heap queue and on a
+    shared memory one, which should be indistinguishable.
+
+    usage: QueueBench [messages] [queue size]
+
+*/
+
+struct Result {
+    double producerMps;
+    double consumerMps;
+    uint64_t delivered;
+    uint64_t lost;
+    uint64_t stalls;
+    uint64_t errors;
+};
+
+static Result run(QueueMode mode, bool shared, size_t consumers, size_t batch, uint64_t messages, size_t queueSize) {
+    std::unique_ptr<SPMC_Queue> owned = shared
+        ? SPMC_Queue::createShared("/excelsior.queuebench", queueSize, mode, std::max<size_t>(consumers, 1))
+        : std::make_unique<SPMC_Queue>(queueSize, mode, std::max<size_t>(consumers, 1));
+    SPMC_Queue& queue = *owned;
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> start{false};
+    std::vector<uint64_t> delivered(consumers), lost(consumers), errors(consumers);
+    std::vector<std::chrono::steady_clock::time_point> finished(consumers);
+
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < consumers; ++c) {
+        threads.emplace_back([&, c] {
+            SPMC_Reader reader(queue);
+            std::array<uint8_t, 64> scratch;
+            std::vector<QueueMessage> out(batch);
+            PayloadSize size;
+            ready.fetch_add(1);
+
+            while (batch > 1 && reader.position() < messages) {
+                uint64_t expected = reader.position();
+                auto got = reader.ReadBatch(out);
+                if (got.empty()) {
+                    if (reader.position() == expected) _mm_pause();
+                    continue;
+                }
+                for (const QueueMessage& msg : got) {
+                    uint64_t seq;
+                    std::memcpy(&seq, msg.payload, sizeof(seq));
+                    errors[c] += seq != expected++;
+                }
+                delivered[c] += got.size();
+            }
+
+            while (batch == 1 && reader.position() < messages) {
+                const uint64_t expected = reader.position();
+                ReadStatus status = reader.Read(scratch.data(), size);
+                if (status == ReadStatus::Ok) {
+                    uint64_t seq;
+                    std::memcpy(&seq, scratch.data(), sizeof(seq));
+                    errors[c] += seq != expected;
+                    ++delivered[c];
+                } else if (status == ReadStatus::NotReady) {
+                    _mm_pause();
+                }
+            }
+            lost[c] = reader.lapped();
+            finished[c] = std::chrono::steady_clock::now();
+        });
+    }
+    while (ready.load() < consumers) std::this_thread::yield();
+
+    const auto begin = std::chrono::steady_clock::now();
+    for (uint64_t seq = 0; seq < messages; ++seq) {
+        queue.Stage(36, [seq](uint8_t* data) { std::memcpy(data, &seq, sizeof(seq)); });
+        if ((seq + 1) % batch == 0) queue.Publish();
+    }
+    queue.Publish();
+    const auto produced = std::chrono::steady_clock::now();
+    for (auto& t : threads) t.join();
+
+    Result result{};
+    result.producerMps = messages / std::chrono::duration<double>(produced - begin).count() / 1e6;
+    for (size_t c = 0; c < consumers; ++c) {
+        result.consumerMps += delivered[c] / std::chrono::duration<double>(finished[c] - begin).count() / 1e6;
+        result.delivered += delivered[c];
+        result.lost += lost[c];
+        result.errors += errors[c];
+    }
+    if (consumers) result.consumerMps /= consumers;
+    result.stalls = queue.producerStalls();
+    return result;
+}
+
+int main(int argc, char** argv) {
+    const uint64_t messages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000;
+    const size_t queueSize = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4096;
+
+    std::printf("%-10s %-5s %6s %9s %14s %14s %14s %12s %8s\n",
+                "mode", "mem", "batch", "consumers", "producer Mm/s", "consumer Mm/s", "lost", "stalls", "errors");
+
+    for (QueueMode mode : {QueueMode::Overwrite, QueueMode::Lossless}) {
+        for (size_t batch : {1, 32}) {
+            for (bool shared : {false, true}) {
+                for (size_t consumers : {1, 2, 4, 8}) {
+                    Result r = run(mode, shared, consumers, batch, messages, queueSize);
+                    std::printf("%-10s %-5s %6zu %9zu %14.2f %14.2f %14lu %12lu %8lu\n",
+                                mode == QueueMode::Overwrite ? "overwrite" : "lossless", shared ? "shm" : "heap",
+                                batch, consumers, r.producerMps, r.consumerMps, r.lost, r.stalls, r.errors);
+                }
+            }
+        }
+    }
+    return 0;
+}
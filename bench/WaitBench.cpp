@@ -0,0 +1,92 @@
+#include "../src/utils/SpmcRingBuffer.cpp"
+#include "../src/utils/TscClock.cpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+/*
+
+    Latency vs CPU trade-off of the SPMC_Reader wait strategies.
+
+    The producer publishes a TSC stamp every intervalUs microseconds, the way a quiet symbol ticks
+    between bursts. The consumer measures publish to read latency and how much CPU its thread
+    burned while doing so.
+
+    usage: WaitBench [messages] [intervalUs]
+
+*/
+
+static double threadCpuSeconds() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void run(const char* name, WaitStrategy strategy, uint64_t messages, uint64_t intervalNs) {
+    SPMC_Queue queue(4096);
+    std::vector<uint64_t> latencies;
+    latencies.reserve(messages);
+    double cpuSeconds = 0;
+    uint64_t sleeps = 0;
+    uint64_t lost = 0;
+    std::atomic<bool> ready{false};
+
+    std::thread consumer([&] {
+        SPMC_Reader reader(queue, false, strategy);
+        std::array<uint8_t, 64> scratch;
+        PayloadSize size;
+        ready = true;
+
+        const double cpuStart = threadCpuSeconds();
+        while (reader.position() < messages) {
+            ReadStatus status = reader.Read(scratch.data(), size);
+            if (status != ReadStatus::Ok) {
+                if (status == ReadStatus::NotReady) reader.Wait();
+                continue;
+            }
+            const uint64_t received = TscClock::now();
+            uint64_t sent;
+            std::memcpy(&sent, scratch.data(), sizeof(sent));
+            latencies.push_back(TscClock::toNs(received - sent));
+        }
+        cpuSeconds = threadCpuSeconds() - cpuStart;
+        sleeps = reader.sleeps();
+        lost = reader.lapped();
+    });
+    while (!ready) std::this_thread::yield();
+
+    const auto begin = std::chrono::steady_clock::now();
+    uint64_t next = TscClock::now();
+    for (uint64_t i = 0; i < messages; ++i) {
+        next += TscClock::toTicks(intervalNs);
+        TscClock::waitUntil(next);
+        const uint64_t stamp = TscClock::now();
+        queue.Write(sizeof(stamp), [stamp](uint8_t* data) { std::memcpy(data, &stamp, sizeof(stamp)); });
+    }
+    consumer.join();
+    const double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto pct = [&](double p) { return latencies[std::min<size_t>(latencies.size() - 1, latencies.size() * p)]; };
+
+    std::printf("%-11s %10lu %10lu %10lu %10lu %9.1f%% %10lu %10lu\n", name,
+                pct(0.50), pct(0.99), pct(0.999), latencies.back(),
+                100.0 * cpuSeconds / wallSeconds, sleeps, lost);
+}
+
+int main(int argc, char** argv) {
+    const uint64_t messages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100'000;
+    const uint64_t intervalNs = (argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20) * 1000;
+
+    TscClock::calibrate();
+    std::printf("%-11s %10s %10s %10s %10s %10s %10s %10s\n",
+                "strategy", "p50 ns", "p99 ns", "p99.9 ns", "max ns", "cpu", "sleeps", "lost");
+
+    run("busy-spin", WaitStrategy::BusySpin, messages, intervalNs);
+    run("spin-yield", WaitStrategy::SpinYield, messages, intervalNs);
+    run("blocking", WaitStrategy::Blocking, messages, intervalNs);
+    return 0;
+}
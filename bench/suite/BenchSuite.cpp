@@ -0,0 +1,938 @@
+#include "Harness.hpp"
+#include "BookCheck.hpp"
+#include "PerfCounters.hpp"
+#include "../../include/parser/ItchGenerator.hpp"
+#include "../../include/parser/ItchParser.hpp"
+#include "../../include/parser/GapRecovery.hpp"
+#include "../../include/parser/MoldUdp64.hpp"
+#include "../../include/orderbook/BookManager.hpp"
+#include "../../include/orderbook/BookPublisher.hpp"
+#include "../../include/orderbook/Orderbook.hpp"
+#include "../../include/orderbook/OrderStore.hpp"
+#include <absl/container/flat_hash_map.h>
+#include <boost/container/flat_map.hpp>
+#include <sys/utsname.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <thread>
+#include <unordered_map>
+
+/*
+
+    The benchmark suite: generates a deterministic synthetic ITCH 5.0 session (ItchGenerator),
+    then runs each scenario over it and reports wall time and throughput as JSON.
+
+        frame           hop the length prefixes with nextMsg, the floor for everything else
+        decode          decode every message into an envelope, nothing published
+        parse_publish   MmapReader::parse into an SPMC_Queue nobody reads, per message and batched
+        ring_N          parse into a Lossless queue read in full by N consumers, 1/2/4/8
+        book            parse into a Lossless queue, one consumer applies it to an Orderbook
+        book_reference  the same into a plain hash map + flat_map book, the baseline to beat
+        book_workers_N  the same through a BookManager with N workers splitting the symbols, 2/4
+        book_check      book against a std::map/std::list ShadowBook after every message and in
+                        full at the end, on a 64 slot ladder so recentring and overflow run; fails the run
+        book_workers_check_N  BookManager with N workers and a thread forcing moves, every symbol
+                        compared against the ShadowBook at the end, 2/4
+        book_l2         book plus a BookPublisher writing every top 10 change to a second ring
+        book_conflated  book plus a BookPublisher in Latest mode, drained by a subscriber thread
+        mold_pcap       the session as a pcap of MoldUDP64 packets (written before timing), through
+                        PcapReader and MoldUdp64Session into an SPMC_Queue; fails unless every
+                        message arrives in sequence
+        mold_udp        the same sent by LoopbackSender over a loopback socket to a UdpReader on its
+                        own thread, throttled on the receive buffer so nothing is dropped; fails the same way
+        mold_recovery   mold_udp with every 1000th packet dropped, GapRecovery fetching the holes from
+                        a RerequestServer; fails unless nothing is lost, reports gaps and recovery time
+        store_flat      the order flow's reference lookups alone against OrderStore, pre-sized
+        store_absl      ... against absl::flat_hash_map, reserved the same
+        store_std       ... against std::unordered_map, reserved the same
+
+    usage: excelsior-bench [--messages N] [--symbols N] [--seed N] [--repeats N]
+                           [--scenario name,...] [--json file|-] [--file path] [--keep] [--perf]
+                           [--input itch-file]
+
+    --input replays an existing ITCH 5.0 file, e.g. a real NASDAQ day, instead of generating one.
+
+    --perf adds hardware counters per message (cycles, instructions, IPC, L1d/L1i/LLC/dTLB misses,
+    branch misses) for the parse loop and the consumer loop, see PerfCounters.hpp. Counters the
+    kernel refuses are left out and the run carries on. The consumer counters are paused while a
+    consumer waits on the parser, so they count reading and consuming only.
+
+    make bench-json runs it with the defaults and writes bench-results.json.
+
+*/
+
+SPMC_Queue* ITCH::MmapReader::buffer_ = nullptr;
+
+namespace {
+
+    constexpr size_t QUEUE_SIZE = 1 << 16;
+    constexpr size_t READ_BATCH = 64;
+    constexpr uint16_t MOLD_PORT = 26400;
+    // Holes far enough apart that each is filled before the next, and room to park the live
+    // packets behind one even when the rerequest server waits a scheduler slice for a core
+    constexpr uint64_t MOLD_DROP_EVERY = 1000;
+    constexpr size_t MOLD_HOLD_PACKETS = 2048;
+
+    struct Options {
+        ITCH::GeneratorConfig generator;
+        uint32_t repeats = 3;
+        std::vector<std::string> scenarios;
+        std::string json = "-";
+        std::string file;
+        std::string input;
+        bool keep = false;
+    };
+
+    // Plain hash map and flat_map levels, the baseline a dedicated book has to beat
+    class ReferenceBook {
+    public:
+        ReferenceBook() : levels(UINT16_MAX + 1) {}
+
+        void apply(const uint8_t* payload) {
+            switch (static_cast<char>(payload[0])) {
+                case ITCH::AddOrderMsgType:
+                case ITCH::AddOrderMPIDAttributionMsgType: {
+                    const auto& m = *reinterpret_cast<const ITCH::AddOrderMsg*>(payload);
+                    add(m.orderId, {m.price, m.quantity, m.securityNameIdx, m.side});
+                    break;
+                }
+                case ITCH::OrderExecutedMsgType: {
+                    const auto& m = *reinterpret_cast<const ITCH::OrderExecutedMsg*>(payload);
+                    reduce(m.orderId, m.executedQuantity);
+                    break;
+                }
+                case ITCH::OrderExecutedWithPriceMsgType: {
+                    const auto& m = *reinterpret_cast<const ITCH::OrderExecutedWithPriceMsg*>(payload);
+                    reduce(m.orderId, m.executedQuantity);
+                    break;
+                }
+                case ITCH::OrderCancelMsgType: {
+                    const auto& m = *reinterpret_cast<const ITCH::OrderCancelMsg*>(payload);
+                    reduce(m.orderId, m.cancelledQuantity);
+                    break;
+                }
+                case ITCH::OrderDeleteMsgType: {
+                    const auto& m = *reinterpret_cast<const ITCH::OrderDeleteMsg*>(payload);
+                    reduce(m.orderId, UINT32_MAX);
+                    break;
+                }
+                case ITCH::OrderReplaceMsgType: {
+                    const auto& m = *reinterpret_cast<const ITCH::OrderReplaceMsg*>(payload);
+                    auto it = orders.find(m.ogOrderId);
+                    if (it == orders.end()) {
+                        ++unknown;
+                        break;
+                    }
+                    Resting replacement{m.price, m.quantity, it->second.locate, it->second.side};
+                    reduce(m.ogOrderId, UINT32_MAX);
+                    add(m.newOrderId, replacement);
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+        size_t openOrders() const { return orders.size(); }
+        uint64_t unknownOrders() const { return unknown; }
+
+    private:
+        struct Resting {
+            uint32_t price;
+            uint32_t shares;
+            uint16_t locate;
+            char     side;
+        };
+
+        using Levels = boost::container::flat_map<uint32_t, uint64_t>;
+
+        absl::flat_hash_map<uint64_t, Resting> orders;
+        std::vector<std::array<Levels, 2>> levels;
+        uint64_t unknown = 0;
+
+        Levels& sideOf(const Resting& r) { return levels[r.locate][r.side == ITCH::Side::BUY ? 0 : 1]; }
+
+        void add(uint64_t ref, const Resting& r) {
+            orders[ref] = r;
+            sideOf(r)[r.price] += r.shares;
+        }
+
+        void reduce(uint64_t ref, uint32_t shares) {
+            auto it = orders.find(ref);
+            if (it == orders.end()) {
+                ++unknown;
+                return;
+            }
+            Resting& r = it->second;
+            const uint32_t removed = std::min(shares, r.shares);
+
+            Levels& side = sideOf(r);
+            auto level = side.find(r.price);
+            if (level != side.end() && (level->second -= removed) == 0) side.erase(level);
+
+            r.shares -= removed;
+            if (r.shares == 0) orders.erase(it);
+        }
+    };
+
+    // The order flow reduced to what a reference store sees: add, take shares off, replace
+    struct StoreOp {
+        char     kind;          // 'A' add, 'R' reduce (E/C/X/D), 'U' replace
+        uint32_t shares;        // UINT32_MAX for a delete
+        uint64_t ref;
+        uint64_t newRef;
+    };
+
+    struct StoreReplay {
+        std::vector<StoreOp> ops;
+        size_t peakOrders = 0;  // what a previous session's peak would tell us
+    };
+
+    // Parses the whole feed, so main builds it once before any store_* scenario is timed
+    StoreReplay buildStoreReplay(const char* path) {
+        StoreReplay replay;
+        std::vector<StoreOp>& ops = replay.ops;
+        absl::flat_hash_map<uint64_t, uint32_t> open;
+        ITCH::MmapReader reader(path);
+        reader.parseParallel(1, [&](size_t, uint64_t, const ITCH::MsgEnvelope& env) {
+            const char* p = env.payload;
+            switch (env.type) {
+                case ITCH::AddOrderMsgType:
+                case ITCH::AddOrderMPIDAttributionMsgType: {
+                    const auto& m = *reinterpret_cast<const ITCH::AddOrderMsg*>(p);
+                    ops.push_back({'A', m.quantity, m.orderId, 0});
+                    open.try_emplace(m.orderId, m.quantity);
+                    break;
+                }
+                case ITCH::OrderExecutedMsgType: {
+                    const auto& m = *reinterpret_cast<const ITCH::OrderExecutedMsg*>(p);
+                    ops.push_back({'R', m.executedQuantity, m.orderId, 0});
+                    break;
+                }
+                case ITCH::OrderExecutedWithPriceMsgType: {
+                    const auto& m = *reinterpret_cast<const ITCH::OrderExecutedWithPriceMsg*>(p);
+                    ops.push_back({'R', m.executedQuantity, m.orderId, 0});
+                    break;
+                }
+                case ITCH::OrderCancelMsgType: {
+                    const auto& m = *reinterpret_cast<const ITCH::OrderCancelMsg*>(p);
+                    ops.push_back({'R', m.cancelledQuantity, m.orderId, 0});
+                    break;
+                }
+                case ITCH::OrderDeleteMsgType: {
+                    const auto& m = *reinterpret_cast<const ITCH::OrderDeleteMsg*>(p);
+                    ops.push_back({'R', UINT32_MAX, m.orderId, 0});
+                    break;
+                }
+                case ITCH::OrderReplaceMsgType: {
+                    const auto& m = *reinterpret_cast<const ITCH::OrderReplaceMsg*>(p);
+                    ops.push_back({'U', m.quantity, m.ogOrderId, m.newOrderId});
+                    if (open.erase(m.ogOrderId)) open.try_emplace(m.newOrderId, m.quantity);
+                    break;
+                }
+                default:
+                    return;
+            }
+
+            const StoreOp& op = ops.back();
+            if (op.kind == 'R') {
+                auto it = open.find(op.ref);
+                if (it != open.end() && (op.shares >= it->second || (it->second -= op.shares) == 0)) open.erase(it);
+            }
+            replay.peakOrders = std::max(replay.peakOrders, open.size());
+        });
+        return replay;
+    }
+
+    // Reference -> remaining shares, through OrderStore or through a standard style hash map
+    struct FlatStore {
+        OrderStore<uint32_t> store;
+
+        explicit FlatStore(size_t expected) : store(expected) {}
+
+        void add(uint64_t ref, uint32_t shares) {
+            const OrderHandle handle = store.insert(ref);
+            if (handle != NO_ORDER) store[handle] = shares;
+        }
+
+        uint32_t* find(uint64_t ref) {
+            const OrderHandle handle = store.find(ref);
+            return handle == NO_ORDER ? nullptr : &store[handle];
+        }
+
+        void erase(uint64_t ref) { store.erase(ref); }
+        size_t size() const { return store.size(); }
+    };
+
+    template <typename Map>
+    struct MapStore {
+        Map map;
+
+        explicit MapStore(size_t expected) { map.reserve(expected); }
+
+        void add(uint64_t ref, uint32_t shares) { map.try_emplace(ref, shares); }
+
+        uint32_t* find(uint64_t ref) {
+            auto it = map.find(ref);
+            return it == map.end() ? nullptr : &it->second;
+        }
+
+        void erase(uint64_t ref) { map.erase(ref); }
+        size_t size() const { return map.size(); }
+    };
+
+    template <typename Store>
+    Bench::RunOutput storeScenario(const StoreReplay& replay) {
+        Bench::PerfCounters counters;
+        counters.start();
+
+        Store store(replay.peakOrders);
+        uint64_t unknown = 0;
+        for (const StoreOp& op : replay.ops) {
+            if (op.kind == 'A') {
+                store.add(op.ref, op.shares);
+                continue;
+            }
+
+            uint32_t* shares = store.find(op.ref);
+            if (!shares) {
+                ++unknown;
+                continue;
+            }
+            if (op.kind == 'U') {
+                store.erase(op.ref);
+                store.add(op.newRef, op.shares);
+            } else if (op.shares >= *shares) {
+                store.erase(op.ref);
+            } else {
+                *shares -= op.shares;
+            }
+        }
+        const Bench::PerfSample sample = counters.stop();
+
+        Bench::RunOutput out{replay.ops.size(), 0, {
+            {"open_orders", static_cast<double>(store.size())},
+            {"peak_orders", static_cast<double>(replay.peakOrders)},
+            {"unknown_orders", static_cast<double>(unknown)}
+        }};
+        Bench::addPerMessage(out.metrics, "store", sample, replay.ops.size());
+        return out;
+    }
+
+    Bench::RunOutput frameScenario(const char* path) {
+        ITCH::MmapReader reader(path);
+        Bench::PerfCounters counters;
+        uint64_t messages = 0;
+        uint8_t types = 0;
+
+        counters.start();
+        while (const char* raw = reader.nextMsg()) {
+            types ^= static_cast<uint8_t>(raw[0]);
+            ++messages;
+        }
+        const Bench::PerfSample sample = counters.stop();
+
+        Bench::RunOutput out{messages, reader.size(), {{"type_xor", static_cast<double>(types)}}};
+        Bench::addPerMessage(out.metrics, "frame", sample, messages);
+        return out;
+    }
+
+    Bench::RunOutput decodeScenario(const char* path) {
+        ITCH::MmapReader reader(path);
+        // parseParallel decodes on a thread of its own, inherit follows it there
+        Bench::PerfCounters counters(true);
+        uint64_t messages = 0;
+
+        counters.start();
+        reader.parseParallel(1, [&](size_t, uint64_t, const ITCH::MsgEnvelope&) { ++messages; });
+        const Bench::PerfSample sample = counters.stop();
+
+        Bench::RunOutput out{messages, reader.size(), {}};
+        Bench::addPerMessage(out.metrics, "decode", sample, messages);
+        return out;
+    }
+
+    Bench::RunOutput parsePublishScenario(const char* path, uint32_t batch) {
+        SPMC_Queue queue(QUEUE_SIZE);
+        ITCH::MmapReader reader(path);
+        reader.setBuffer(&queue);
+        reader.setPublishBatch(batch);
+
+        Bench::PerfCounters counters;
+        counters.start();
+        reader.parse();
+        const Bench::PerfSample sample = counters.stop();
+
+        reader.setPublishBatch(1);
+        reader.setBuffer(nullptr);
+
+        Bench::RunOutput out{queue.head(), reader.size(), {}};
+        Bench::addPerMessage(out.metrics, "parse", sample, queue.head());
+        return out;
+    }
+
+    // Parse on this thread into a Lossless queue, every consumer reads the whole session
+    template <typename Consume>
+    Bench::RunOutput transfer(const char* path, size_t consumers, Consume&& consume) {
+        SPMC_Queue queue(QUEUE_SIZE, QueueMode::Lossless, consumers);
+        ITCH::MmapReader reader(path);
+        reader.setBuffer(&queue);
+        reader.setPublishBatch(32);
+
+        std::atomic<size_t> ready{0};
+        std::atomic<uint64_t> total{UINT64_MAX};
+        std::atomic<uint64_t> delivered{0};
+        std::vector<Bench::PerfSample> consumerSamples(consumers);
+        std::vector<std::thread> threads;
+        for (size_t c = 0; c < consumers; ++c) {
+            threads.emplace_back([&, c] {
+                SPMC_Reader consumer(queue, false, WaitStrategy::SpinYield);
+                std::vector<QueueMessage> batch(READ_BATCH);
+                Bench::PerfCounters counters;
+                ready.fetch_add(1);
+
+                counters.start();
+                uint64_t n = 0;
+                while (consumer.position() < total.load(std::memory_order_relaxed)) {
+                    auto got = consumer.ReadBatch(batch);
+                    if (got.empty()) {
+                        // Waiting on the parser is not consuming
+                        counters.pause();
+                        consumer.Wait();
+                        counters.resume();
+                        continue;
+                    }
+                    for (const QueueMessage& m : got) consume(c, m.payload);
+                    n += got.size();
+                }
+                consumerSamples[c] = counters.stop();
+                delivered.fetch_add(n);
+            });
+        }
+        while (ready.load() < consumers) std::this_thread::yield();
+
+        // Opened after the consumers started, so this only counts the parser
+        Bench::PerfCounters counters;
+        counters.start();
+        reader.parse();
+        const Bench::PerfSample parseSample = counters.stop();
+
+        total.store(queue.head());
+        for (auto& t : threads) t.join();
+
+        reader.setPublishBatch(1);
+        reader.setBuffer(nullptr);
+
+        Bench::PerfSample consumerSample;
+        for (const Bench::PerfSample& s : consumerSamples) consumerSample += s;
+
+        Bench::RunOutput out{queue.head(), reader.size(), {{"delivered", static_cast<double>(delivered.load())}}};
+        Bench::addPerMessage(out.metrics, "parse", parseSample, queue.head());
+        Bench::addPerMessage(out.metrics, "consumer", consumerSample, delivered.load());
+        return out;
+    }
+
+    Bench::RunOutput ringScenario(const char* path, size_t consumers) {
+        std::vector<uint64_t> checksums(consumers * 8);
+        auto out = transfer(path, consumers, [&](size_t c, const uint8_t* payload) {
+            checksums[c * 8] += payload[0];     // one cache line per consumer
+        });
+        for (size_t c = 1; c < consumers; ++c) {
+            if (checksums[c * 8] != checksums[0]) out.metrics.push_back({"checksum_mismatch", 1});
+        }
+        return out;
+    }
+
+    Bench::RunOutput bookScenario(const char* path) {
+        // Sized for the generated session, a full day wants the default or more
+        Orderbook book({.expectedOrders = 1 << 16});
+        auto out = transfer(path, 1, [&](size_t, const uint8_t* payload) { book.apply(payload); });
+        out.metrics.push_back({"open_orders", static_cast<double>(book.openOrders())});
+        out.metrics.push_back({"unknown_orders", static_cast<double>(book.stats().unknownOrders)});
+        return out;
+    }
+
+    Bench::RunOutput bookPublishScenario(const char* path, Conflation conflation) {
+        Orderbook book({.expectedOrders = 1 << 16});
+        SPMC_Queue ring(QUEUE_SIZE);
+        BookPublisher publisher(book, ring, {.conflation = conflation});
+        BookSubscriber& subscriber = publisher.subscribe();
+
+        // A consumer slower than the book, for Latest it only ever sees each symbol's newest state
+        std::atomic<bool> done{false};
+        uint64_t snapshots = 0;
+        std::thread drain([&] {
+            uint16_t locate;
+            BookSnapshot snapshot;
+            while (!done.load(std::memory_order_relaxed)) {
+                if (subscriber.next(locate, snapshot)) ++snapshots;
+                else std::this_thread::yield();
+            }
+        });
+
+        auto out = transfer(path, 1, [&](size_t, const uint8_t* payload) {
+            if (book.apply(payload)) publisher.publish(payload);
+        });
+        done.store(true);
+        drain.join();
+
+        out.metrics.push_back({"ring_messages", static_cast<double>(publisher.ringMessages())});
+        out.metrics.push_back({"conflated_updates", static_cast<double>(publisher.conflatedUpdates())});
+        out.metrics.push_back({"snapshots_read", static_cast<double>(snapshots)});
+        return out;
+    }
+
+    Bench::RunOutput bookWorkersScenario(const char* path, size_t workers) {
+        SPMC_Queue queue(QUEUE_SIZE, QueueMode::Lossless, workers);
+        BookManagerConfig config;
+        config.workers = workers;
+        config.book.expectedOrders = 1 << 16;
+        config.rebalanceIntervalMs = 100;
+        BookManager manager(queue, config);
+
+        ITCH::MmapReader reader(path);
+        reader.setBuffer(&queue);
+        reader.setPublishBatch(32);
+        reader.parse();
+        while (manager.position() < queue.head()) std::this_thread::yield();
+        manager.stop();
+
+        reader.setPublishBatch(1);
+        reader.setBuffer(nullptr);
+
+        size_t open = 0;
+        for (size_t w = 0; w < workers; ++w) open += manager.book(w).openOrders();
+        return {queue.head(), reader.size(), {
+            {"open_orders", static_cast<double>(open)},
+            {"moves", static_cast<double>(manager.moves())}
+        }};
+    }
+
+    Bench::RunOutput bookCheckScenario(const char* path) {
+        Orderbook book({.expectedOrders = 1 << 16, .ladderSlots = 64, .maxLadderSlots = 64});
+        Bench::ShadowBook shadow;
+        std::string error;
+        auto out = transfer(path, 1, [&](size_t, const uint8_t* payload) {
+            book.apply(payload);
+            shadow.apply(payload);
+            if (error.empty()) error = shadow.compareTouched(book, payload);
+        });
+        if (error.empty()) error = shadow.compareAll([&](uint16_t) -> const Orderbook& { return book; });
+        if (error.empty() && book.openOrders() != shadow.openOrders()) error = "open order counts differ";
+        if (!error.empty()) throw std::runtime_error("book_check: " + error);
+
+        out.metrics.push_back({"open_orders", static_cast<double>(book.openOrders())});
+        return out;
+    }
+
+    Bench::RunOutput bookWorkersCheckScenario(const char* path, size_t workers) {
+        SPMC_Queue queue(QUEUE_SIZE, QueueMode::Lossless, workers + 1);
+        BookManagerConfig config;
+        config.workers = workers;
+        config.book.expectedOrders = 1 << 16;
+        config.rebalanceIntervalMs = 0;
+        BookManager manager(queue, config);
+
+        // The shadow reads the same queue, and the symbol it saw last is the next one to move
+        std::atomic<uint64_t> total{UINT64_MAX};
+        std::atomic<uint16_t> lastLocate{0};
+        Bench::ShadowBook shadow;
+        std::atomic<bool> shadowReady{false};
+        std::thread shadowThread([&] {
+            SPMC_Reader reader(queue, false, WaitStrategy::SpinYield);
+            std::vector<QueueMessage> batch(READ_BATCH);
+            shadowReady.store(true);
+            while (reader.position() < total.load(std::memory_order_relaxed)) {
+                auto got = reader.ReadBatch(batch);
+                if (got.empty()) {
+                    reader.Wait();
+                    continue;
+                }
+                for (const QueueMessage& m : got) {
+                    shadow.apply(m.payload);
+                    uint16_t locate;
+                    std::memcpy(&locate, m.payload + offsetof(ITCH::AddOrderMsg, securityNameIdx), sizeof(locate));
+                    if (locate != MARKET_WIDE_LOCATE) lastLocate.store(locate, std::memory_order_relaxed);
+                }
+            }
+        });
+        while (!shadowReady.load()) std::this_thread::yield();
+
+        std::atomic<bool> parsing{true};
+        std::thread mover([&] {
+            while (parsing.load()) {
+                const uint16_t locate = lastLocate.load(std::memory_order_relaxed);
+                if (locate) manager.move(locate, (manager.workerOf(locate) + 1) % workers);
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        });
+
+        ITCH::MmapReader reader(path);
+        reader.setBuffer(&queue);
+        reader.setPublishBatch(32);
+        reader.parse();
+        parsing.store(false);
+        mover.join();
+
+        total.store(queue.head());
+        shadowThread.join();
+        while (manager.position() < queue.head()) std::this_thread::yield();
+        manager.stop();
+
+        reader.setPublishBatch(1);
+        reader.setBuffer(nullptr);
+
+        size_t open = 0;
+        for (size_t w = 0; w < workers; ++w) open += manager.book(w).openOrders();
+        std::string error = shadow.compareAll([&](uint16_t locate) -> const Orderbook& { return manager.bookOf(locate); });
+        if (error.empty() && open != shadow.openOrders()) error = "open order counts differ";
+        if (!error.empty()) throw std::runtime_error("book_workers_check: " + error);
+
+        return {queue.head(), reader.size(), {
+            {"open_orders", static_cast<double>(open)},
+            {"moves", static_cast<double>(manager.moves())}
+        }};
+    }
+
+    // Anything short of the whole session in sequence fails the run
+    void checkMold(const char* name, const ITCH::MoldUdp64Session& session, const SPMC_Queue& queue, uint64_t expected) {
+        const ITCH::MoldSessionStats stats = session.stats();
+        if (stats.messages == expected && stats.missedMessages == 0 && stats.malformed == 0 && queue.head() == expected) return;
+        throw std::runtime_error(std::string(name) + ": delivered " + std::to_string(stats.messages) + " of " +
+                                 std::to_string(expected) + " messages, " + std::to_string(stats.missedMessages) +
+                                 " missed, " + std::to_string(stats.malformed) + " malformed packets, " +
+                                 std::to_string(queue.head()) + " published");
+    }
+
+    Bench::RunOutput moldPcapScenario(const std::string& pcap, uint64_t expected) {
+        SPMC_Queue queue(QUEUE_SIZE);
+        ITCH::MmapReader::setBuffer(&queue);
+        ITCH::MmapReader::setPublishBatch(32);
+
+        ITCH::PcapReader reader(pcap.c_str(), MOLD_PORT);
+        ITCH::MoldUdp64Session session;
+        const uint64_t packets = reader.run(session);
+
+        ITCH::MmapReader::setPublishBatch(1);
+        ITCH::MmapReader::setBuffer(nullptr);
+        checkMold("mold_pcap", session, queue, expected);
+
+        return {queue.head(), std::filesystem::file_size(pcap), {{"packets", static_cast<double>(packets)}}};
+    }
+
+    Bench::RunOutput moldUdpScenario(const char* path, uint64_t expected) {
+        SPMC_Queue queue(QUEUE_SIZE);
+        ITCH::MmapReader::setBuffer(&queue);
+        ITCH::MmapReader::setPublishBatch(32);
+
+        ITCH::UdpReader receiver(0, nullptr, "127.0.0.1");
+        ITCH::MoldUdp64Session session;
+        std::atomic<bool> running{true};
+        std::thread receive([&] { receiver.run(session, running); });
+
+        ITCH::LoopbackSender sender(receiver.port());
+        sender.throttle(receiver.socketFd());
+        const uint64_t sent = sender.sendFile(path);
+        sender.sendEndOfSession(sent + 1);
+
+        // A lost end of session must not hang the suite, the count check below reports the loss
+        const auto deadline = Bench::Clock::now() + std::chrono::seconds(2);
+        while (!session.endOfSession() && Bench::Clock::now() < deadline) std::this_thread::yield();
+        running.store(false);
+        receive.join();
+
+        ITCH::MmapReader::setPublishBatch(1);
+        ITCH::MmapReader::setBuffer(nullptr);
+        checkMold("mold_udp", session, queue, expected);
+
+        return {queue.head(), std::filesystem::file_size(path), {
+            {"packets", static_cast<double>(session.stats().packets)}
+        }};
+    }
+
+    Bench::RunOutput moldRecoveryScenario(const char* path, uint64_t expected) {
+        SPMC_Queue queue(QUEUE_SIZE);
+        ITCH::MmapReader::setBuffer(&queue);
+        ITCH::MmapReader::setPublishBatch(32);
+
+        ITCH::RerequestServer server(path);
+        server.start();
+
+        ITCH::UdpReader receiver(0, nullptr, "127.0.0.1");
+        ITCH::MoldUdp64Session session;
+        ITCH::GapRecovery recovery(session, "127.0.0.1", server.port(), {.holdPackets = MOLD_HOLD_PACKETS});
+        std::atomic<bool> running{true};
+        std::atomic<bool> finished{false};
+        std::thread receive([&] {
+            recovery.run(receiver, running);
+            finished.store(true);
+        });
+
+        ITCH::LoopbackSender sender(receiver.port());
+        sender.throttle(receiver.socketFd());
+        const uint64_t sent = sender.sendFile(path, UINT64_MAX, std::chrono::nanoseconds(0), MOLD_DROP_EVERY);
+        sender.sendEndOfSession(sent + 1);
+
+        // run() returns once the session ended with no gap open, give up on a lost end of session
+        const auto deadline = Bench::Clock::now() + std::chrono::seconds(2);
+        while (!finished.load() && Bench::Clock::now() < deadline) std::this_thread::yield();
+        running.store(false);
+        receive.join();
+        server.stop();
+
+        ITCH::MmapReader::setPublishBatch(1);
+        ITCH::MmapReader::setBuffer(nullptr);
+
+        const ITCH::RecoveryStats stats = recovery.stats();
+        if (stats.messagesLost != 0 || stats.gapsAbandoned != 0) {
+            throw std::runtime_error("mold_recovery: " + std::to_string(stats.messagesLost) + " messages lost in " +
+                                     std::to_string(stats.gapsAbandoned) + " abandoned gaps");
+        }
+        checkMold("mold_recovery", session, queue, expected);
+
+        return {queue.head(), std::filesystem::file_size(path), {
+            {"gaps_detected", static_cast<double>(stats.gapsDetected)},
+            {"messages_recovered", static_cast<double>(stats.messagesRecovered)},
+            {"requests_sent", static_cast<double>(stats.requestsSent)},
+            {"max_held_packets", static_cast<double>(stats.maxHeldPackets)},
+            {"total_recovery_ns", static_cast<double>(stats.totalRecoveryNs)},
+            {"max_recovery_ns", static_cast<double>(stats.maxRecoveryNs)}
+        }};
+    }
+
+    Bench::RunOutput referenceBookScenario(const char* path) {
+        ReferenceBook book;
+        auto out = transfer(path, 1, [&](size_t, const uint8_t* payload) { book.apply(payload); });
+        out.metrics.push_back({"open_orders", static_cast<double>(book.openOrders())});
+        out.metrics.push_back({"unknown_orders", static_cast<double>(book.unknownOrders())});
+        return out;
+    }
+
+    // Counts for an input file, in the generator's terms so the report looks the same
+    ITCH::GeneratorStats scanFeed(const char* path) {
+        ITCH::MmapReader reader(path);
+        ITCH::GeneratorStats feed;
+        while (const char* raw = reader.nextMsg()) {
+            ++feed.messages;
+            ++feed.perType[static_cast<uint8_t>(raw[0])];
+        }
+        feed.bytes = reader.size();
+        feed.ordersAdded = feed.perType[ITCH::AddOrderMsgType] + feed.perType[ITCH::AddOrderMPIDAttributionMsgType];
+        return feed;
+    }
+
+    std::string commit() {
+        if (const char* env = std::getenv("EXCELSIOR_COMMIT")) return env;
+
+        std::string hash;
+        if (FILE* p = popen("git rev-parse --short HEAD 2>/dev/null", "r")) {
+            char line[64];
+            if (std::fgets(line, sizeof(line), p)) hash.assign(line, std::strcspn(line, "\n"));
+            pclose(p);
+        }
+        return hash.empty() ? "unknown" : hash;
+    }
+
+    bool wanted(const Options& options, const std::string& name) {
+        if (options.scenarios.empty()) return true;
+        for (const std::string& s : options.scenarios) {
+            if (name.compare(0, s.size(), s) == 0) return true;
+        }
+        return false;
+    }
+
+    Options parseOptions(int argc, char** argv) {
+        Options o;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            auto value = [&]() -> const char* {
+                if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+                return argv[++i];
+            };
+
+            if (arg == "--messages") o.generator.messages = std::strtoull(value(), nullptr, 10);
+            else if (arg == "--symbols") o.generator.symbols = static_cast<uint32_t>(std::strtoul(value(), nullptr, 10));
+            else if (arg == "--seed") o.generator.seed = std::strtoull(value(), nullptr, 10);
+            else if (arg == "--repeats") o.repeats = static_cast<uint32_t>(std::strtoul(value(), nullptr, 10));
+            else if (arg == "--json") o.json = value();
+            else if (arg == "--file") o.file = value();
+            else if (arg == "--input") o.input = value();
+            else if (arg == "--keep") o.keep = true;
+            else if (arg == "--perf") Bench::perfEnabled = true;
+            else if (arg == "--scenario") {
+                std::string list = value();
+                for (size_t pos = 0; pos <= list.size();) {
+                    const size_t comma = std::min(list.find(',', pos), list.size());
+                    if (comma > pos) o.scenarios.push_back(list.substr(pos, comma - pos));
+                    pos = comma + 1;
+                }
+            }
+            else throw std::invalid_argument("Unknown option " + arg);
+        }
+        if (!o.input.empty()) {
+            o.file = o.input;
+            o.keep = true;
+        }
+        else if (o.file.empty()) {
+            o.file = "/tmp/excelsior-bench-" + std::to_string(o.generator.seed) + "-" +
+                     std::to_string(o.generator.messages) + ".itch";
+        }
+        return o;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 2;
+    }
+
+    const char* path = options.file.c_str();
+    ITCH::GeneratorStats feed;
+    if (options.input.empty()) {
+        ITCH::ItchGenerator generator(options.generator);
+        feed = generator.writeFile(path);
+        std::fprintf(stderr, "generated %lu messages, %lu bytes, %lu orders into %s\n",
+                     feed.messages, feed.bytes, feed.ordersAdded, path);
+    } else {
+        try {
+            feed = scanFeed(path);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
+        std::fprintf(stderr, "replaying %lu messages, %lu bytes, %lu orders from %s\n",
+                     feed.messages, feed.bytes, feed.ordersAdded, path);
+    }
+
+    // Find out once which counters this machine gives us, carry on without them if it gives none
+    const bool perfRequested = Bench::perfEnabled;
+    std::vector<std::string> perfEvents;
+    std::string perfReason;
+    if (perfRequested) {
+        Bench::PerfCounters probe;
+        probe.start();
+        const Bench::PerfSample sample = probe.stop();
+        for (size_t i = 0; i < Bench::PERF_EVENTS; ++i) {
+            if (sample.valid[i]) perfEvents.push_back(Bench::PERF_EVENT_NAMES[i]);
+        }
+        if (perfEvents.empty()) {
+            perfReason = Bench::PerfCounters::unavailableReason();
+            Bench::perfEnabled = false;
+            std::fprintf(stderr, "hardware counters unavailable: %s, timing only\n", perfReason.c_str());
+        }
+    }
+
+    using Scenario = std::pair<std::string, std::function<Bench::RunOutput()>>;
+    std::vector<Scenario> scenarios = {
+        {"frame", [&] { return frameScenario(path); }},
+        {"decode", [&] { return decodeScenario(path); }},
+        {"parse_publish", [&] { return parsePublishScenario(path, 1); }},
+        {"parse_publish_batch32", [&] { return parsePublishScenario(path, 32); }},
+    };
+    for (size_t consumers : {1, 2, 4, 8}) {
+        scenarios.emplace_back("ring_" + std::to_string(consumers), [&, consumers] { return ringScenario(path, consumers); });
+    }
+    scenarios.emplace_back("book", [&] { return bookScenario(path); });
+    scenarios.emplace_back("book_reference", [&] { return referenceBookScenario(path); });
+    for (size_t workers : {2, 4}) {
+        scenarios.emplace_back("book_workers_" + std::to_string(workers), [&, workers] { return bookWorkersScenario(path, workers); });
+    }
+    scenarios.emplace_back("book_check", [&] { return bookCheckScenario(path); });
+    for (size_t workers : {2, 4}) {
+        scenarios.emplace_back("book_workers_check_" + std::to_string(workers), [&, workers] {
+            return bookWorkersCheckScenario(path, workers);
+        });
+    }
+    scenarios.emplace_back("book_l2", [&] { return bookPublishScenario(path, Conflation::None); });
+    scenarios.emplace_back("book_conflated", [&] { return bookPublishScenario(path, Conflation::Latest); });
+
+    // Written once up front so mold_pcap times reading packets, not making them
+    const std::string pcap = options.file + ".pcap";
+    if (wanted(options, "mold_pcap")) ITCH::writeMoldPcap(path, pcap.c_str(), MOLD_PORT);
+    scenarios.emplace_back("mold_pcap", [&] { return moldPcapScenario(pcap, feed.messages); });
+    scenarios.emplace_back("mold_udp", [&] { return moldUdpScenario(path, feed.messages); });
+    scenarios.emplace_back("mold_recovery", [&] { return moldRecoveryScenario(path, feed.messages); });
+
+    StoreReplay replay;
+    if (wanted(options, "store_flat") || wanted(options, "store_absl") || wanted(options, "store_std")) {
+        replay = buildStoreReplay(path);
+    }
+    scenarios.emplace_back("store_flat", [&] { return storeScenario<FlatStore>(replay); });
+    scenarios.emplace_back("store_absl", [&] {
+        return storeScenario<MapStore<absl::flat_hash_map<uint64_t, uint32_t>>>(replay);
+    });
+    scenarios.emplace_back("store_std", [&] {
+        return storeScenario<MapStore<std::unordered_map<uint64_t, uint32_t>>>(replay);
+    });
+
+    std::vector<Bench::Result> results;
+    Bench::printHeader(stderr);
+    for (auto& [name, run] : scenarios) {
+        if (!wanted(options, name)) continue;
+        try {
+            results.push_back(Bench::measure(name, options.repeats, run));
+        } catch (const std::exception& e) {
+            // A checked scenario found the book wrong, no point reporting timings
+            std::fprintf(stderr, "%s\n", e.what());
+            std::remove(pcap.c_str());
+            if (!options.keep) std::remove(path);
+            return 1;
+        }
+        Bench::printRow(results.back(), stderr);
+    }
+
+    FILE* out = options.json == "-" ? stdout : std::fopen(options.json.c_str(), "w");
+    if (!out) {
+        std::fprintf(stderr, "Failed to open %s\n", options.json.c_str());
+        return 1;
+    }
+
+    utsname host{};
+    uname(&host);
+
+    Bench::Json json(out);
+    json.beginObject();
+    json.field("suite", "excelsior");
+    json.field("schema", uint64_t(1));
+    json.field("commit", commit());
+    json.field("date", Bench::utcNow());
+    json.beginObject("host");
+    json.field("name", host.nodename);
+    json.field("kernel", host.release);
+    json.field("cpus", static_cast<uint64_t>(std::thread::hardware_concurrency()));
+    json.field("compiler", __VERSION__);
+    json.endObject();
+    json.beginObject("perf");
+    json.field("requested", static_cast<uint64_t>(perfRequested));
+    json.field("available", static_cast<uint64_t>(!perfEvents.empty()));
+    if (!perfReason.empty()) json.field("reason", perfReason);
+    json.beginArray("events");
+    for (const std::string& e : perfEvents) json.field(nullptr, e);
+    json.endArray();
+    json.endObject();
+    json.beginObject("feed");
+    if (!options.input.empty()) json.field("input", options.input);
+    else json.field("seed", options.generator.seed);
+    json.field("messages", feed.messages);
+    json.field("bytes", feed.bytes);
+    if (options.input.empty()) json.field("symbols", static_cast<uint64_t>(options.generator.symbols));
+    json.field("orders", feed.ordersAdded);
+    json.endObject();
+    Bench::writeResults(json, results);
+    json.endObject();
+    json.finish();
+
+    if (out != stdout) std::fclose(out);
+    std::remove(pcap.c_str());
+    if (!options.keep) std::remove(path);
+    return 0;
+}
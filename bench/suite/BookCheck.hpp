@@ -0,0 +1,257 @@
+#pragma once
+
+#include "../../include/orderbook/Orderbook.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+
+    A deliberately naive L3 book the checked scenarios compare Orderbook against: std::map levels
+    holding a std::list of references in time priority, and a hash map from reference to order.
+    It applies messages with exactly Orderbook's rules (unknown references ignored, duplicates
+    rejected, a replace goes to the back of its new level) so any difference in depth, level
+    counts or queue positions is a bug in the book, its ladder or a move between workers.
+
+*/
+
+namespace Bench {
+
+    class ShadowBook {
+    public:
+        static constexpr size_t TOP_LEVELS = 10;
+
+        ShadowBook() : books(UINT16_MAX + 1) {}
+
+        void apply(const uint8_t* payload) {
+            switch (static_cast<char>(payload[0])) {
+                case ITCH::AddOrderMsgType:
+                case ITCH::AddOrderMPIDAttributionMsgType: {
+                    const auto& m = *reinterpret_cast<const ITCH::AddOrderMsg*>(payload);
+                    insert(m.securityNameIdx, m.orderId, m.side, m.quantity, m.price);
+                    break;
+                }
+                case ITCH::OrderExecutedMsgType: {
+                    const auto& m = *reinterpret_cast<const ITCH::OrderExecutedMsg*>(payload);
+                    reduce(m.orderId, m.executedQuantity);
+                    break;
+                }
+                case ITCH::OrderExecutedWithPriceMsgType: {
+                    const auto& m = *reinterpret_cast<const ITCH::OrderExecutedWithPriceMsg*>(payload);
+                    reduce(m.orderId, m.executedQuantity);
+                    break;
+                }
+                case ITCH::OrderCancelMsgType: {
+                    const auto& m = *reinterpret_cast<const ITCH::OrderCancelMsg*>(payload);
+                    reduce(m.orderId, m.cancelledQuantity);
+                    break;
+                }
+                case ITCH::OrderDeleteMsgType: {
+                    const auto& m = *reinterpret_cast<const ITCH::OrderDeleteMsg*>(payload);
+                    reduce(m.orderId, UINT32_MAX);
+                    break;
+                }
+                case ITCH::OrderReplaceMsgType: {
+                    const auto& m = *reinterpret_cast<const ITCH::OrderReplaceMsg*>(payload);
+                    auto it = orders.find(m.ogOrderId);
+                    if (it == orders.end()) break;
+                    const uint16_t locate = it->second.locate;
+                    const char side = it->second.side;
+                    reduce(m.ogOrderId, UINT32_MAX);
+                    insert(locate, m.newOrderId, side, m.quantity, m.price);
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+        size_t openOrders() const { return orders.size(); }
+
+        // The first maxLevels levels of both sides, price, order count and shares. Empty when equal.
+        std::string compareDepth(const Orderbook& book, uint16_t locate, size_t maxLevels) const {
+            for (char side : {ITCH::Side::BUY, ITCH::Side::SELL}) {
+                const Levels& levels = sideOf(locate, side);
+                if (maxLevels == SIZE_MAX && book.levels(locate, side) != levels.size()) {
+                    return where(locate, side) + " has " + std::to_string(book.levels(locate, side)) +
+                           " levels, expected " + std::to_string(levels.size());
+                }
+
+                const size_t want = std::min(maxLevels, levels.size());
+                std::vector<BookLevel> got(want + 1);
+                const size_t n = book.depth(locate, side, got);
+                if (n != std::min(want + 1, levels.size())) {
+                    return where(locate, side) + " depth returned " + std::to_string(n) + " levels";
+                }
+
+                size_t i = 0;
+                auto check = [&](const auto& entry) -> std::string {
+                    const BookLevel expected{entry.first, static_cast<uint32_t>(entry.second.queue.size()), entry.second.shares};
+                    if (got[i] == expected) return {};
+                    return where(locate, side) + " level " + std::to_string(i) + " is " + describe(got[i]) +
+                           ", expected " + describe(expected);
+                };
+                std::string error;
+                if (side == ITCH::Side::BUY) {
+                    for (auto it = levels.rbegin(); it != levels.rend() && i < want && error.empty(); ++it, ++i) error = check(*it);
+                } else {
+                    for (auto it = levels.begin(); it != levels.end() && i < want && error.empty(); ++it, ++i) error = check(*it);
+                }
+                if (!error.empty()) return error;
+            }
+            return {};
+        }
+
+        // One reference's queue position, or its absence. Empty when equal.
+        std::string compareOrder(const Orderbook& book, uint64_t ref) const {
+            const std::optional<QueuePosition> got = book.queuePosition(ref);
+            auto it = orders.find(ref);
+            if (it == orders.end()) {
+                return got ? "order " + std::to_string(ref) + " should not be on the book" : std::string();
+            }
+
+            const Order& order = it->second;
+            const Level& level = sideOf(order.locate, order.side).at(order.price);
+            QueuePosition expected{order.locate, order.side, order.price, order.shares, 0, 0};
+            for (auto q = level.queue.begin(); *q != ref; ++q) {
+                ++expected.ordersAhead;
+                expected.sharesAhead += orders.at(*q).shares;
+            }
+            return samePosition(ref, got, expected);
+        }
+
+        // After apply(payload) on both: the touched symbol's top levels and the orders it names
+        std::string compareTouched(const Orderbook& book, const uint8_t* payload) const {
+            uint64_t refs[2];
+            size_t n = 0;
+            switch (static_cast<char>(payload[0])) {
+                case ITCH::AddOrderMsgType:
+                case ITCH::AddOrderMPIDAttributionMsgType:
+                    refs[n++] = reinterpret_cast<const ITCH::AddOrderMsg*>(payload)->orderId;
+                    break;
+                case ITCH::OrderExecutedMsgType:
+                    refs[n++] = reinterpret_cast<const ITCH::OrderExecutedMsg*>(payload)->orderId;
+                    break;
+                case ITCH::OrderExecutedWithPriceMsgType:
+                    refs[n++] = reinterpret_cast<const ITCH::OrderExecutedWithPriceMsg*>(payload)->orderId;
+                    break;
+                case ITCH::OrderCancelMsgType:
+                    refs[n++] = reinterpret_cast<const ITCH::OrderCancelMsg*>(payload)->orderId;
+                    break;
+                case ITCH::OrderDeleteMsgType:
+                    refs[n++] = reinterpret_cast<const ITCH::OrderDeleteMsg*>(payload)->orderId;
+                    break;
+                case ITCH::OrderReplaceMsgType:
+                    refs[n++] = reinterpret_cast<const ITCH::OrderReplaceMsg*>(payload)->ogOrderId;
+                    refs[n++] = reinterpret_cast<const ITCH::OrderReplaceMsg*>(payload)->newOrderId;
+                    break;
+                default:
+                    return {};
+            }
+
+            uint16_t locate;
+            std::memcpy(&locate, payload + offsetof(ITCH::AddOrderMsg, securityNameIdx), sizeof(locate));
+            std::string error = compareDepth(book, locate, TOP_LEVELS);
+            for (size_t i = 0; i < n && error.empty(); ++i) error = compareOrder(book, refs[i]);
+            return error;
+        }
+
+        // Every level and every order of every symbol, bookOf(locate) gives the book holding it
+        template <typename BookOf>
+        std::string compareAll(BookOf&& bookOf) const {
+            for (size_t locate = 0; locate <= UINT16_MAX; ++locate) {
+                const Orderbook& book = bookOf(static_cast<uint16_t>(locate));
+                std::string error = compareDepth(book, static_cast<uint16_t>(locate), SIZE_MAX);
+                if (!error.empty()) return error;
+
+                for (char side : {ITCH::Side::BUY, ITCH::Side::SELL}) {
+                    for (const auto& [price, level] : sideOf(static_cast<uint16_t>(locate), side)) {
+                        QueuePosition expected{static_cast<uint16_t>(locate), side, price, 0, 0, 0};
+                        for (uint64_t ref : level.queue) {
+                            expected.shares = orders.at(ref).shares;
+                            error = samePosition(ref, book.queuePosition(ref), expected);
+                            if (!error.empty()) return error;
+                            ++expected.ordersAhead;
+                            expected.sharesAhead += expected.shares;
+                        }
+                    }
+                }
+            }
+            return {};
+        }
+
+    private:
+        struct Level {
+            std::list<uint64_t> queue;
+            uint64_t shares = 0;
+        };
+        using Levels = std::map<uint32_t, Level>;
+
+        struct Order {
+            uint16_t locate;
+            char     side;
+            uint32_t price;
+            uint32_t shares;
+            std::list<uint64_t>::iterator position;
+        };
+
+        std::unordered_map<uint64_t, Order> orders;
+        std::vector<std::array<Levels, 2>> books;
+
+        Levels& sideOf(uint16_t locate, char side) { return books[locate][side == ITCH::Side::BUY ? 0 : 1]; }
+        const Levels& sideOf(uint16_t locate, char side) const { return books[locate][side == ITCH::Side::BUY ? 0 : 1]; }
+
+        void insert(uint16_t locate, uint64_t ref, char side, uint32_t shares, uint32_t price) {
+            if (orders.contains(ref)) return;
+            Level& level = sideOf(locate, side)[price];
+            level.queue.push_back(ref);
+            level.shares += shares;
+            orders.emplace(ref, Order{locate, side, price, shares, std::prev(level.queue.end())});
+        }
+
+        void reduce(uint64_t ref, uint32_t shares) {
+            auto it = orders.find(ref);
+            if (it == orders.end()) return;
+
+            Order& order = it->second;
+            Levels& levels = sideOf(order.locate, order.side);
+            Level& level = levels.at(order.price);
+            const uint32_t removed = std::min(shares, order.shares);
+            level.shares -= removed;
+            order.shares -= removed;
+            if (order.shares) return;
+
+            level.queue.erase(order.position);
+            if (level.queue.empty()) levels.erase(order.price);
+            orders.erase(it);
+        }
+
+        static std::string where(uint16_t locate, char side) {
+            return "locate " + std::to_string(locate) + " side " + side;
+        }
+
+        static std::string describe(const BookLevel& level) {
+            return std::to_string(level.price) + "/" + std::to_string(level.orders) + "/" + std::to_string(level.shares);
+        }
+
+        static std::string samePosition(uint64_t ref, const std::optional<QueuePosition>& got, const QueuePosition& expected) {
+            if (!got) return "order " + std::to_string(ref) + " is missing from the book";
+            if (got->locate == expected.locate && got->side == expected.side && got->price == expected.price &&
+                got->shares == expected.shares && got->ordersAhead == expected.ordersAhead &&
+                got->sharesAhead == expected.sharesAhead) return {};
+            return "order " + std::to_string(ref) + " sits at " + std::to_string(got->price) + " with " +
+                   std::to_string(got->ordersAhead) + " orders ahead, expected " + std::to_string(expected.price) +
+                   " with " + std::to_string(expected.ordersAhead);
+        }
+    };
+
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+
+    Timing and reporting for the benchmark suite. A scenario is a function that processes a
+    known number of messages once; the harness runs it a few times, keeps the best and median
+    wall time and writes everything as JSON so results can be diffed across commits.
+
+*/
+
+namespace Bench {
+
+    using Clock = std::chrono::steady_clock;
+
+    // One named number a scenario wants reported next to its timing
+    struct Metric {
+        std::string name;
+        double value;
+    };
+
+    // What one run of a scenario returns
+    struct RunOutput {
+        uint64_t messages = 0;
+        uint64_t bytes = 0;
+        std::vector<Metric> metrics;    // from the last run only
+    };
+
+    struct Result {
+        std::string name;
+        uint64_t messages = 0;
+        uint64_t bytes = 0;
+        uint32_t repeats = 0;
+        double bestSeconds = 0.0;
+        double medianSeconds = 0.0;
+        std::vector<Metric> metrics;
+
+        double messagesPerSecond() const { return bestSeconds > 0 ? messages / bestSeconds : 0.0; }
+        double nsPerMessage() const { return messages ? bestSeconds * 1e9 / messages : 0.0; }
+        double megabytesPerSecond() const { return bestSeconds > 0 ? bytes / bestSeconds / 1e6 : 0.0; }
+    };
+
+    template <typename Fn>
+    Result measure(const std::string& name, uint32_t repeats, Fn&& run) {
+        Result result;
+        result.name = name;
+        result.repeats = std::max<uint32_t>(repeats, 1);
+
+        std::vector<double> seconds;
+        for (uint32_t i = 0; i < result.repeats; ++i) {
+            const auto begin = Clock::now();
+            RunOutput out = run();
+            seconds.push_back(std::chrono::duration<double>(Clock::now() - begin).count());
+
+            result.messages = out.messages;
+            result.bytes = out.bytes;
+            result.metrics = std::move(out.metrics);
+        }
+
+        std::sort(seconds.begin(), seconds.end());
+        result.bestSeconds = seconds.front();
+        result.medianSeconds = seconds[seconds.size() / 2];
+        return result;
+    }
+
+    inline void printHeader(FILE* out) {
+        std::fprintf(out, "%-24s %12s %10s %10s %10s\n", "scenario", "messages", "Mmsg/s", "ns/msg", "MB/s");
+    }
+
+    inline void printRow(const Result& r, FILE* out) {
+        std::fprintf(out, "%-24s %12lu %10.2f %10.2f %10.1f", r.name.c_str(), r.messages,
+                     r.messagesPerSecond() / 1e6, r.nsPerMessage(), r.megabytesPerSecond());
+        for (const Metric& m : r.metrics) std::fprintf(out, "  %s=%g", m.name.c_str(), m.value);
+        std::fputc('\n', out);
+    }
+
+    // Minimal JSON writer, enough for flat objects and arrays of them
+    class Json {
+    public:
+        explicit Json(FILE* out) : out_(out) {}
+
+        void beginObject(const char* key = nullptr) { open(key, '{'); }
+        void endObject() { close('}'); }
+        void beginArray(const char* key = nullptr) { open(key, '['); }
+        void endArray() { close(']'); }
+
+        void field(const char* key, const std::string& value) {
+            separator(key);
+            std::fputc('"', out_);
+            for (char c : value) {
+                if (c == '"' || c == '\\') std::fputc('\\', out_);
+                std::fputc(c, out_);
+            }
+            std::fputc('"', out_);
+        }
+
+        void field(const char* key, const char* value) { field(key, std::string(value)); }
+        void field(const char* key, uint64_t value) { separator(key); std::fprintf(out_, "%lu", value); }
+        void field(const char* key, double value) { separator(key); std::fprintf(out_, "%.6g", value); }
+
+        void finish() { std::fputc('\n', out_); }
+
+    private:
+        FILE* out_;
+        std::vector<bool> first_;
+
+        void separator(const char* key) {
+            if (!first_.empty()) {
+                if (!first_.back()) std::fputc(',', out_);
+                first_.back() = false;
+            }
+            if (key) std::fprintf(out_, "\"%s\":", key);
+        }
+
+        void open(const char* key, char bracket) {
+            separator(key);
+            std::fputc(bracket, out_);
+            first_.push_back(true);
+        }
+
+        void close(char bracket) {
+            first_.pop_back();
+            std::fputc(bracket, out_);
+        }
+    };
+
+    inline void writeResults(Json& json, const std::vector<Result>& results) {
+        json.beginArray("scenarios");
+        for (const Result& r : results) {
+            json.beginObject();
+            json.field("name", r.name);
+            json.field("messages", r.messages);
+            json.field("bytes", r.bytes);
+            json.field("repeats", static_cast<uint64_t>(r.repeats));
+            json.field("best_seconds", r.bestSeconds);
+            json.field("median_seconds", r.medianSeconds);
+            json.field("msgs_per_sec", r.messagesPerSecond());
+            json.field("ns_per_msg", r.nsPerMessage());
+            json.field("mb_per_sec", r.megabytesPerSecond());
+            json.beginObject("metrics");
+            for (const Metric& m : r.metrics) json.field(m.name.c_str(), m.value);
+            json.endObject();
+            json.endObject();
+        }
+        json.endArray();
+    }
+
+    inline std::string utcNow() {
+        char buffer[32];
+        const std::time_t now = std::time(nullptr);
+        std::tm tm{};
+        gmtime_r(&now, &tm);
+        std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &tm);
+        return buffer;
+    }
+
+}
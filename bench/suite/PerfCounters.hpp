@@ -0,0 +1,207 @@
+#pragma once
+
+#include "Harness.hpp"
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+/*
+
+    Hardware counters around a region of the benchmark, through perf_event_open.
+
+    Counters belong to the thread that creates the PerfCounters (and, with inherit, to threads it
+    starts afterwards), so each consumer thread opens its own. Events are opened one by one rather
+    than as a group: whichever ones the PMU or the sandbox refuses are just missing from the
+    report, and the kernel multiplexes the rest if there are more events than counters, which the
+    enabled/running times scale back out.
+
+    Nothing is opened unless the suite runs with --perf.
+
+*/
+
+namespace Bench {
+
+    enum class PerfEvent : uint8_t {
+        Cycles,
+        Instructions,
+        L1DMisses,
+        L1IMisses,
+        LLCMisses,
+        BranchMisses,
+        DTLBMisses,
+        Count
+    };
+
+    inline constexpr size_t PERF_EVENTS = static_cast<size_t>(PerfEvent::Count);
+
+    inline constexpr std::array<const char*, PERF_EVENTS> PERF_EVENT_NAMES = {
+        "cycles", "instructions", "l1d_misses", "l1i_misses", "llc_misses", "branch_misses", "dtlb_misses"
+    };
+
+    // Set by --perf before any scenario runs
+    inline bool perfEnabled = false;
+
+    struct PerfSample {
+        std::array<double, PERF_EVENTS> values{};
+        std::array<bool, PERF_EVENTS> valid{};
+
+        bool any() const {
+            for (bool v : valid) if (v) return true;
+            return false;
+        }
+
+        // Sum of per-thread samples, an event counts only if every thread had it
+        PerfSample& operator+=(const PerfSample& other) {
+            const bool empty = !any();
+            for (size_t i = 0; i < PERF_EVENTS; ++i) {
+                values[i] += other.values[i];
+                valid[i] = other.valid[i] && (empty || valid[i]);
+            }
+            return *this;
+        }
+    };
+
+    class PerfCounters {
+    public:
+        explicit PerfCounters(bool inherit = false) {
+            fds_.fill(-1);
+            if (!perfEnabled) return;
+
+            for (size_t i = 0; i < PERF_EVENTS; ++i) {
+                perf_event_attr attr{};
+                attr.size = sizeof(attr);
+                attr.disabled = 1;
+                attr.inherit = inherit;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                describe(static_cast<PerfEvent>(i), attr);
+
+                fds_[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+                if (fds_[i] == -1) lastError().store(errno, std::memory_order_relaxed);
+            }
+        }
+
+        PerfCounters(const PerfCounters& other) = delete;
+        PerfCounters& operator=(const PerfCounters& other) = delete;
+
+        ~PerfCounters() {
+            for (int fd : fds_) {
+                if (fd != -1) close(fd);
+            }
+        }
+
+        void start() {
+            for (int fd : fds_) {
+                if (fd == -1) continue;
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+
+        PerfSample stop() {
+            for (int fd : fds_) {
+                if (fd != -1) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+
+            PerfSample sample;
+            for (size_t i = 0; i < PERF_EVENTS; ++i) {
+                uint64_t data[3];   // value, time enabled, time running
+                if (fds_[i] == -1 || read(fds_[i], data, sizeof(data)) != sizeof(data) || data[2] == 0) continue;
+                sample.values[i] = static_cast<double>(data[0]) * static_cast<double>(data[1]) / static_cast<double>(data[2]);
+                sample.valid[i] = true;
+            }
+            return sample;
+        }
+
+        // Leave a stretch out of the count, e.g. a consumer waiting on the producer. Each is an
+        // ioctl per event, so call them around waits rather than around every message.
+        void pause() {
+            for (int fd : fds_) {
+                if (fd != -1) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+
+        void resume() {
+            for (int fd : fds_) {
+                if (fd != -1) ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+
+        bool available() const {
+            for (int fd : fds_) if (fd != -1) return true;
+            return false;
+        }
+
+        // Why the last event failed to open, for the report when nothing could be measured
+        static std::string unavailableReason() {
+            const int error = lastError().load(std::memory_order_relaxed);
+            std::string reason = error ? std::strerror(error) : "not requested";
+            std::ifstream paranoid("/proc/sys/kernel/perf_event_paranoid");
+            int level;
+            if (paranoid >> level) reason += " (perf_event_paranoid=" + std::to_string(level) + ")";
+            return reason;
+        }
+
+    private:
+        std::array<int, PERF_EVENTS> fds_;
+
+        // Every consumer thread opens counters, so this is written concurrently
+        static std::atomic<int>& lastError() {
+            static std::atomic<int> error{0};
+            return error;
+        }
+
+        static void describe(PerfEvent event, perf_event_attr& attr) {
+            auto cache = [&](uint64_t cache) {
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            };
+
+            switch (event) {
+                case PerfEvent::Cycles:
+                    attr.type = PERF_TYPE_HARDWARE;
+                    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                    break;
+                case PerfEvent::Instructions:
+                    attr.type = PERF_TYPE_HARDWARE;
+                    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+                    break;
+                case PerfEvent::BranchMisses:
+                    attr.type = PERF_TYPE_HARDWARE;
+                    attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+                    break;
+                case PerfEvent::L1DMisses:  cache(PERF_COUNT_HW_CACHE_L1D); break;
+                case PerfEvent::L1IMisses:  cache(PERF_COUNT_HW_CACHE_L1I); break;
+                case PerfEvent::LLCMisses:  cache(PERF_COUNT_HW_CACHE_LL); break;
+                case PerfEvent::DTLBMisses: cache(PERF_COUNT_HW_CACHE_DTLB); break;
+                case PerfEvent::Count: break;
+            }
+        }
+    };
+
+    // Per message figures for one region, e.g. "parse.cycles_per_msg", plus IPC
+    inline void addPerMessage(std::vector<Metric>& metrics, const std::string& region,
+                              const PerfSample& sample, uint64_t messages) {
+        if (!messages || !sample.any()) return;
+
+        for (size_t i = 0; i < PERF_EVENTS; ++i) {
+            if (!sample.valid[i]) continue;
+            metrics.push_back({region + "." + PERF_EVENT_NAMES[i] + "_per_msg", sample.values[i] / messages});
+        }
+
+        const size_t cycles = static_cast<size_t>(PerfEvent::Cycles);
+        const size_t instructions = static_cast<size_t>(PerfEvent::Instructions);
+        if (sample.valid[cycles] && sample.valid[instructions] && sample.values[cycles] > 0) {
+            metrics.push_back({region + ".ipc", sample.values[instructions] / sample.values[cycles]});
+        }
+    }
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include "BookPublisher.hpp"
+#include "Orderbook.hpp"
+#include "../../src/utils/SpmcRingBuffer.cpp"
+
+/*
+
+    Drains an SPMC_Queue of decoded messages on its own thread and applies the order flow to an
+    Orderbook. The book belongs to the builder's thread while it runs: read it from elsewhere only
+    after the builder is destroyed. With a BookPublisher, every message that changed the book is
+    also published as L1/L2 updates from the same thread.
+
+    A lapped reader would go on applying the flow to a book that already lost messages, so the
+    queue must be Lossless and the constructor rejects any other. The builder's reader is
+    registered before the constructor returns, so the producer can start right after.
+
+*/
+
+class BookBuilder {
+public:
+    // queue must be QueueMode::Lossless with a free consumer slot
+    BookBuilder(SPMC_Queue& queue, Orderbook& book, WaitStrategy strategy = WaitStrategy::SpinYield,
+                BookPublisher* publisher = nullptr);
+
+    BookBuilder(const BookBuilder& other) = delete;
+    BookBuilder& operator=(const BookBuilder& other) = delete;
+
+    ~BookBuilder();
+
+    // Messages taken off the queue so far, order flow or not
+    uint64_t processed() const { return processed_.load(std::memory_order_relaxed); }
+
+private:
+    void pollLoop();
+
+    SPMC_Queue& queue_;
+    Orderbook& book_;
+    WaitStrategy strategy_;
+    BookPublisher* publisher_;
+    std::atomic<bool> running_;
+    std::atomic<bool> ready_;
+    std::atomic<uint64_t> processed_;
+    std::thread worker_;
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Orderbook.hpp"
+#include "../../src/utils/ShardedQueue.cpp"
+
+/*
+
+    Builds the books for every symbol on a fixed number of worker threads.
+
+    Each worker reads the whole SPMC_Queue with its own reader and applies only the stock locates
+    it owns to its own Orderbook, so there is no sharing on the hot path: one table lookup decides
+    whether a message is skipped. Locates are dealt out by a PartitionFn at start and workers can
+    be pinned to cores.
+
+    Workers count messages per locate. A rebalancer thread turns the counts into rates every
+    interval and, when the busiest worker carries more than its share by the configured margin,
+    moves the symbol that best evens the two out to the least loaded worker. Moves only start at
+    quiet points, when both workers are within quietBacklog messages of the head.
+
+    A move hands a symbol over at an exact queue sequence. Both workers acknowledge at a batch
+    boundary and the handover sequence is the later of the two positions. The giving worker applies
+    the symbol up to that sequence, then extracts its orders (time priority preserved). The taking
+    worker skips the symbol below it and adopts the orders before applying anything at or past it.
+    Every message is applied exactly once, by the owner at its sequence. This relies on the queue
+    being Lossless, which is also what keeps the handover range in the ring, so the constructor
+    rejects any other queue. stop() finishes a move it interrupts after the extract.
+
+*/
+
+struct BookManagerConfig {
+    size_t workers = 4;
+    std::vector<int> cores;                 // worker i runs on cores[i % cores.size()], empty: not pinned
+    BookConfig book;                        // per worker
+    PartitionFn partition = &moduloPartition;
+    WaitStrategy strategy = WaitStrategy::SpinYield;
+    uint32_t rebalanceIntervalMs = 1000;    // 0: only rebalance() and move() by hand
+    double imbalance = 0.25;                // act when busiest - idlest exceeds this share of the mean
+    uint64_t quietBacklog = 1024;           // both workers at most this far behind the head
+};
+
+class BookManager {
+public:
+    // queue must be QueueMode::Lossless with a free consumer slot per worker
+    BookManager(SPMC_Queue& queue, const BookManagerConfig& config = {});
+
+    BookManager(const BookManager& other) = delete;
+    BookManager& operator=(const BookManager& other) = delete;
+
+    ~BookManager();
+
+    // Stop the workers, after which the books can be read from any thread. A move caught between
+    // the giver's extract and the taker's adopt is completed here, one that had not extracted yet is dropped.
+    void stop();
+
+    // Any thread, the two are serialised. Start at most one move if the measured rates call for it,
+    // true if one was made
+    bool rebalance();
+
+    // Any thread. Hand a locate to another worker and wait for the handover, false if already there or stopped
+    bool move(uint16_t locate, size_t worker);
+
+    size_t workerCount() const { return workers.size(); }
+
+    // Any thread. Changes when a move completes, so during one it still names the giving worker.
+    size_t workerOf(uint16_t locate) const { return owner[locate].load(std::memory_order_relaxed); }
+
+    // A worker's book, only safe to read after stop()
+    const Orderbook& book(size_t worker) const { return *workers[worker]->book; }
+    const Orderbook& bookOf(uint16_t locate) const { return book(workerOf(locate)); }
+
+    // Lowest queue position across workers: everything before it is on the books
+    uint64_t position() const;
+
+    uint64_t moves() const { return completedMoves; }
+
+private:
+    static constexpr uint64_t NO_SEQ = UINT64_MAX;
+    static constexpr size_t READ_BATCH = 64;
+    static constexpr size_t LOCATES = UINT16_MAX + 1;
+
+    // One handover in flight at a time, shared by the two workers involved
+    struct Move {
+        uint64_t id;
+        uint16_t locate;
+        size_t from;
+        size_t to;
+        std::atomic<uint64_t> fromAt{NO_SEQ};       // each side's position when it acknowledged
+        std::atomic<uint64_t> toAt{NO_SEQ};
+        std::atomic<bool> packed{false};
+        std::atomic<bool> done{false};
+        std::vector<ExportedOrder> orders;
+    };
+
+    struct Worker {
+        size_t id;
+        std::unique_ptr<Orderbook> book;
+        std::vector<uint8_t> owned;                             // by locate, only this worker touches it
+        std::unique_ptr<std::atomic<uint32_t>[]> counts;        // messages applied per locate
+        alignas(64) std::atomic<uint64_t> position{0};
+        std::atomic<uint64_t> seenMove{0};                      // id of the newest move it has looked at
+        uint64_t handoverAt = NO_SEQ;                           // sequence of the move it has acknowledged
+        uint64_t lastMove = 0;                                  // id of the last move it finished its part of
+        std::thread thread;
+    };
+
+    SPMC_Queue& queue;
+    BookManagerConfig config;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::unique_ptr<std::atomic<uint16_t>[]> owner; // written under controlMutex when a move completes
+    std::vector<uint32_t> lastCounts;               // summed per locate at the previous rebalance
+    std::atomic<Move*> pending{nullptr};
+    std::vector<std::unique_ptr<Move>> moveLog;     // oldest first, until no worker can still hold them
+    uint64_t movesStarted = 0;
+    std::atomic<bool> running{true};
+    std::atomic<size_t> ready{0};
+    uint64_t completedMoves = 0;
+
+    std::mutex controlMutex;                        // serialises rebalance() and move()
+    std::mutex stopMutex;
+    std::condition_variable stopSignal;
+    std::thread rebalancer;
+
+    void run(Worker& worker);
+    void apply(Worker& worker, const uint8_t* payload);
+    void serviceMove(Worker& worker, uint64_t position);
+    void handover(Worker& worker, Move* move, uint64_t position);
+    bool execute(uint16_t locate, size_t from, size_t to);
+    void trimMoveLog();
+    void rebalanceLoop();
+};
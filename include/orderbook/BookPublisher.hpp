@@ -0,0 +1,169 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+#include "Orderbook.hpp"
+#include "../../src/utils/SpmcRingBuffer.cpp"
+
+/*
+
+    Publishes top of book (L1) and top N depth (L2) derived from an Orderbook, so downstream
+    consumers don't have to rebuild the book from the order flow.
+
+    The book's thread calls publish() after every message it applies. The publisher reads the
+    symbol's top levels, compares them to what it last published for that symbol and does nothing
+    when the change was deeper than the published depth. Otherwise, per symbol, either:
+
+    - Conflation::None writes the change to a second SPMC_Queue: a TopOfBookMsg when the best bid
+      or ask changed, and a DepthMsg for every price that entered, changed or left the top N.
+      A consumer that falls behind an Overwrite ring gets Overrun, like any other reader.
+
+    - Conflation::Latest only overwrites the symbol's slot and marks the symbol dirty for every
+      subscriber. A subscriber pops dirty symbols and reads the slot, so however slow it is it
+      sees each changed symbol once, with its latest state, instead of a backlog of stale ones.
+
+    Every symbol's latest snapshot sits in a seqlocked slot whichever the mode, so read() works
+    for both. Slots are allocated the first time a symbol changes.
+
+*/
+
+namespace BookFeed {
+
+    constexpr char TopOfBookMsgType {'Q'};
+    constexpr char DepthMsgType {'L'};
+
+    // Best bid and ask after a change, an empty side has shares == 0
+    struct TopOfBookMsg {
+        char        msgType;
+        uint16_t    locate;
+        uint64_t    update;             // the symbol's change counter, shared by all messages of one change
+        BookLevel   bid;
+        BookLevel   ask;
+    };
+
+    // One price in the top N of a side, shares == 0 when it left the top N
+    struct DepthMsg {
+        char        msgType;
+        char        side;
+        uint16_t    locate;
+        uint64_t    update;
+        BookLevel   level;
+    };
+
+    static_assert(sizeof(TopOfBookMsg) <= 64 && sizeof(DepthMsg) <= 64, "Feed messages must fit a queue block");
+}
+
+enum class Conflation : uint8_t {
+    None,       // every change goes on the ring
+    Latest      // only the latest state, through the slot and the subscribers' dirty queues
+};
+
+// Top levels of a symbol as last published, best first
+struct BookSnapshot {
+    static constexpr size_t MAX_DEPTH = 10;
+
+    uint64_t update = 0;
+    uint8_t bidLevels = 0;
+    uint8_t askLevels = 0;
+    std::array<BookLevel, MAX_DEPTH> bids{};
+    std::array<BookLevel, MAX_DEPTH> asks{};
+};
+
+struct PublisherConfig {
+    size_t depth = BookSnapshot::MAX_DEPTH;     // levels per side, at most MAX_DEPTH
+    Conflation conflation = Conflation::None;   // for symbols without their own setting
+    size_t maxSubscribers = 8;
+};
+
+class BookPublisher;
+
+// A consumer of the conflated symbols, owned by the publisher and used from one thread
+class BookSubscriber {
+public:
+    BookSubscriber(const BookSubscriber& other) = delete;
+    BookSubscriber& operator=(const BookSubscriber& other) = delete;
+
+    // Next dirty symbol and its latest snapshot, false when nothing changed since the last call
+    bool next(uint16_t& locate, BookSnapshot& snapshot);
+
+    // Symbols waiting
+    size_t pending() const;
+
+private:
+    friend class BookPublisher;
+
+    static constexpr size_t LOCATES = UINT16_MAX + 1;
+
+    explicit BookSubscriber(const BookPublisher& publisher);
+
+    // Called by the publisher, a symbol already waiting is not queued again
+    void markDirty(uint16_t locate);
+
+    const BookPublisher& publisher;
+    std::unique_ptr<std::atomic<uint8_t>[]> dirty;
+    std::unique_ptr<uint16_t[]> queue;          // each locate at most once, so it can never fill
+    alignas(64) std::atomic<uint64_t> tail{0};  // written by the publisher
+    alignas(64) std::atomic<uint64_t> head{0};  // written by the subscriber
+};
+
+class BookPublisher {
+public:
+    BookPublisher(const Orderbook& book, SPMC_Queue& ring, const PublisherConfig& config = {});
+
+    BookPublisher(const BookPublisher& other) = delete;
+    BookPublisher& operator=(const BookPublisher& other) = delete;
+
+    // Book thread: call after applying payload, publishes whatever the message changed
+    void publish(const uint8_t* payload);
+    void update(uint16_t locate);
+
+    // Takes effect from the symbol's next change
+    void setConflation(uint16_t locate, Conflation mode);
+    Conflation conflation(uint16_t locate) const;
+
+    // Any thread. Dirty symbols are queued from the next change on, read() gives the state before that.
+    BookSubscriber& subscribe();
+
+    // Any thread: the latest snapshot of a symbol, false if it has not changed since the start
+    bool read(uint16_t locate, BookSnapshot& snapshot) const;
+
+    uint64_t ringMessages() const { return ringCount.load(std::memory_order_relaxed); }
+    uint64_t conflatedUpdates() const { return conflatedCount.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t LOCATES = UINT16_MAX + 1;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> version{0};       // odd while the publisher writes
+        BookSnapshot snapshot;
+    };
+
+    const Orderbook& book;
+    SPMC_Queue& ring;
+    PublisherConfig config;
+
+    std::unique_ptr<std::atomic<Slot*>[]> slots;
+    std::vector<std::unique_ptr<Slot>> slotStorage;     // publisher only
+    std::unique_ptr<std::atomic<Conflation>[]> modes;
+
+    std::vector<std::unique_ptr<BookSubscriber>> subscribers;
+    std::atomic<size_t> subscriberCount{0};
+    std::mutex subscribeMutex;
+
+    std::atomic<uint64_t> ringCount{0};
+    std::atomic<uint64_t> conflatedCount{0};
+    BookSnapshot current;
+
+    Slot& slotFor(uint16_t locate);
+    void write(Slot& slot, const BookSnapshot& snapshot);
+    void publishTop(uint16_t locate, const BookSnapshot& before, const BookSnapshot& after);
+
+    void publishSide(uint16_t locate, char side, uint64_t update,
+                     std::span<const BookLevel> before, std::span<const BookLevel> after);
+};
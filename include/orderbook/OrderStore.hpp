@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/*
+
+    Order reference to order node store, the lookup behind every E/C/X/D/U message.
+
+    References go into a flat open addressed table of (reference, handle) slots with linear
+    probing. Erasing shifts the rest of the probe run back into the hole instead of leaving a
+    tombstone, so after a day of adds and deletes probe lengths are still those of a table that
+    only ever saw inserts, and there is never a cleanup rehash. The home slot is a Fibonacci
+    multiply of the reference, which spreads the exchange's sequential references evenly.
+
+    Nodes live in fixed size slabs addressed by 32-bit handles. Growing adds a slab and never
+    moves a node, and freed nodes are reused last in first out so recently touched memory comes
+    back first. reserve() with the previous session's peak() sizes the table and the slabs up
+    front, after which inserts and erases never allocate.
+
+*/
+
+// Handle of an order node in an OrderStore
+using OrderHandle = uint32_t;
+inline constexpr OrderHandle NO_ORDER = UINT32_MAX;
+
+template <typename Node>
+class OrderStore {
+public:
+    static constexpr size_t SLAB_SHIFT = 16;
+    static constexpr size_t SLAB_SIZE = size_t(1) << SLAB_SHIFT;
+    static constexpr size_t MIN_SLOTS = 16;
+
+    explicit OrderStore(size_t expectedOrders = 0) {
+        rehash(MIN_SLOTS);
+        reserve(expectedOrders);
+    }
+
+    OrderStore(const OrderStore& other) = delete;
+    OrderStore& operator=(const OrderStore& other) = delete;
+
+    void reserve(size_t orders) {
+        while (slabs.size() * SLAB_SIZE < orders) addSlab();
+        const size_t needed = slotsFor(orders);
+        if (needed > slots.size()) rehash(needed);
+    }
+
+    // A fresh node for ref, NO_ORDER if the reference is already in the store
+    OrderHandle insert(uint64_t ref) {
+        if (count >= limit) rehash(slots.size() * 2);
+
+        size_t i = home(ref);
+        for (; slots[i].handle != NO_ORDER; i = (i + 1) & mask) {
+            if (slots[i].ref == ref) return NO_ORDER;
+        }
+
+        const OrderHandle handle = allocate();
+        slots[i] = {ref, handle};
+        peakCount = std::max(++count, peakCount);
+        return handle;
+    }
+
+    OrderHandle find(uint64_t ref) const {
+        for (size_t i = home(ref);; i = (i + 1) & mask) {
+            const Slot& slot = slots[i];
+            if (slot.handle == NO_ORDER) return NO_ORDER;
+            if (slot.ref == ref) return slot.handle;
+        }
+    }
+
+    // Remove ref and free its node, false if it was not there
+    bool erase(uint64_t ref) {
+        size_t hole = home(ref);
+        for (;; hole = (hole + 1) & mask) {
+            if (slots[hole].handle == NO_ORDER) return false;
+            if (slots[hole].ref == ref) break;
+        }
+        release(slots[hole].handle);
+
+        // An entry further along the run may fill the hole if the hole lies between its home and where it sits
+        for (size_t j = (hole + 1) & mask; slots[j].handle != NO_ORDER; j = (j + 1) & mask) {
+            const size_t fromHome = (j - home(slots[j].ref)) & mask;
+            const size_t fromHole = (j - hole) & mask;
+            if (fromHome >= fromHole) {
+                slots[hole] = slots[j];
+                hole = j;
+            }
+        }
+        slots[hole].handle = NO_ORDER;
+        --count;
+        return true;
+    }
+
+    Node& operator[](OrderHandle handle) { return slabs[handle >> SLAB_SHIFT][handle & (SLAB_SIZE - 1)]; }
+    const Node& operator[](OrderHandle handle) const { return slabs[handle >> SLAB_SHIFT][handle & (SLAB_SIZE - 1)]; }
+
+    size_t size() const { return count; }
+    size_t peak() const { return peakCount; }         // most orders held at once, for next session's reserve
+    size_t slotCount() const { return slots.size(); }
+    size_t nodeCapacity() const { return slabs.size() * SLAB_SIZE; }
+
+private:
+    struct Slot {
+        uint64_t    ref;
+        OrderHandle handle;     // NO_ORDER marks an empty slot
+    };
+
+    std::vector<Slot> slots;
+    size_t mask = 0;
+    unsigned shift = 64;
+    size_t limit = 0;           // rehash once count reaches this, 3/4 of the slots
+
+    std::vector<std::unique_ptr<Node[]>> slabs;
+    std::vector<OrderHandle> freeList;
+    OrderHandle nextFresh = 0;
+
+    size_t count = 0;
+    size_t peakCount = 0;
+
+    static size_t slotsFor(size_t orders) {
+        return std::max(MIN_SLOTS, std::bit_ceil(orders + orders / 3 + 1));
+    }
+
+    size_t home(uint64_t ref) const {
+        return static_cast<size_t>((ref * 0x9E3779B97F4A7C15ull) >> shift);
+    }
+
+    void rehash(size_t size) {
+        std::vector<Slot> old = std::move(slots);
+        slots.assign(size, Slot{0, NO_ORDER});
+        mask = size - 1;
+        shift = 64 - std::countr_zero(size);
+        limit = size / 4 * 3;
+
+        for (const Slot& slot : old) {
+            if (slot.handle == NO_ORDER) continue;
+            size_t i = home(slot.ref);
+            while (slots[i].handle != NO_ORDER) i = (i + 1) & mask;
+            slots[i] = slot;
+        }
+    }
+
+    void addSlab() {
+        slabs.push_back(std::make_unique_for_overwrite<Node[]>(SLAB_SIZE));
+        freeList.reserve(nodeCapacity());
+    }
+
+    OrderHandle allocate() {
+        if (!freeList.empty()) {
+            const OrderHandle handle = freeList.back();
+            freeList.pop_back();
+            return handle;
+        }
+        if (nextFresh == nodeCapacity()) addSlab();
+        return nextFresh++;
+    }
+
+    void release(OrderHandle handle) {
+        freeList.push_back(handle);
+    }
+};
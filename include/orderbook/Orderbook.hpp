@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <vector>
+#include "../parser/ItchMessages.hpp"
+#include "OrderStore.hpp"
+#include "PriceLadder.hpp"
+
+/*
+
+    Order by order (L3) books for every symbol of an ITCH feed, indexed by stock locate.
+
+    Resting orders live in one OrderStore shared by all symbols, which maps the reference to a
+    32-bit handle of a pooled node (references are unique for the whole day). Each price level
+    keeps its orders in an intrusive doubly linked FIFO threaded through the nodes, so time
+    priority is the list order and any order can be unlinked in O(1) once found. Each side's levels
+    are a PriceLadder, a dense array around the touch with a bitmap of the non-empty prices.
+
+    The store is sized up front from BookConfig (the previous session's peakOrders()) and a
+    ladder only allocates when it first sees a price or has to widen, so steady state processing
+    does no heap allocation per message. Sizing too small still works, the containers just grow.
+
+    Executions, cancels, deletes and replaces for references the book never saw (joining the
+    feed late) are counted and ignored.
+
+*/
+
+struct BookConfig {
+    size_t expectedOrders = 1 << 20;    // peak resting orders across all symbols
+    size_t ladderSlots = 64;            // initial price window per symbol and side, in ticks
+    size_t maxLadderSlots = 4096;       // widest window before far prices go to the overflow tree
+};
+
+struct BookStats {
+    uint64_t adds = 0;
+    uint64_t executions = 0;
+    uint64_t cancels = 0;
+    uint64_t deletes = 0;
+    uint64_t replaces = 0;
+    uint64_t unknownOrders = 0;         // reference not on the book
+    uint64_t duplicateOrders = 0;       // add for a reference already on the book
+};
+
+// Aggregated view of one price level, shares == 0 when the side is empty
+struct BookLevel {
+    uint32_t price = 0;
+    uint32_t orders = 0;
+    uint64_t shares = 0;
+
+    bool operator==(const BookLevel& other) const = default;
+};
+
+// A resting order as it moves between books, see Orderbook::extract
+struct ExportedOrder {
+    uint64_t ref;
+    uint32_t price;
+    uint32_t shares;
+    char     side;
+};
+
+// Where an order stands in its level's queue
+struct QueuePosition {
+    uint16_t locate;
+    char     side;
+    uint32_t price;
+    uint32_t shares;            // the order's own remaining shares
+    uint32_t ordersAhead;
+    uint64_t sharesAhead;
+};
+
+class Orderbook {
+public:
+    explicit Orderbook(const BookConfig& config = {});
+
+    Orderbook(const Orderbook& other) = delete;
+    Orderbook& operator=(const Orderbook& other) = delete;
+
+    // Apply one decoded message as published on the ring, false if it does not touch the book
+    bool apply(const uint8_t* payload);
+
+    // The same operations typed, false when the reference is unknown (or already known for add)
+    bool add(uint16_t locate, uint64_t ref, char side, uint32_t shares, uint32_t price);
+    bool execute(uint64_t ref, uint32_t shares);
+    bool cancel(uint64_t ref, uint32_t shares);
+    bool remove(uint64_t ref);
+    bool replace(uint64_t ref, uint64_t newRef, uint32_t shares, uint32_t price);
+
+    BookLevel bestBid(uint16_t locate) const;
+    BookLevel bestAsk(uint16_t locate) const;
+
+    // Top levels of one side, best first, returns how many were written
+    size_t depth(uint16_t locate, char side, std::span<BookLevel> out) const;
+    size_t levels(uint16_t locate, char side) const;
+
+    // Walks the level from its head, so O(orders ahead)
+    std::optional<QueuePosition> queuePosition(uint64_t ref) const;
+
+    // Move a whole symbol out of this book, bids then asks, best level first and each level in
+    // time priority, so adopt() on another book rebuilds it with the same queue positions
+    void extract(uint16_t locate, std::vector<ExportedOrder>& out);
+    void adopt(uint16_t locate, std::span<const ExportedOrder> orders);
+
+    size_t openOrders() const { return orders.size(); }
+    size_t peakOrders() const { return orders.peak(); }
+    const BookStats& stats() const { return counters; }
+
+private:
+    struct RestingOrder {
+        uint64_t    ref;
+        uint32_t    price;
+        uint32_t    shares;
+        OrderHandle prev;
+        OrderHandle next;
+        uint16_t    locate;
+        char        side;
+    };
+
+    struct Level {
+        uint64_t    shares = 0;
+        uint32_t    orders = 0;
+        OrderHandle head = NO_ORDER;
+        OrderHandle tail = NO_ORDER;
+    };
+
+    using Bids = PriceLadder<Level, true>;
+    using Asks = PriceLadder<Level, false>;
+
+    struct SymbolBook {
+        Bids bids;
+        Asks asks;
+    };
+
+    BookConfig config;
+    BookStats counters;
+    OrderStore<RestingOrder> orders;
+    std::vector<SymbolBook> books;
+
+    template <typename Fn>
+    decltype(auto) onSide(SymbolBook& book, char side, Fn&& fn);
+
+    template <typename Levels>
+    void link(Levels& levels, OrderHandle handle);
+
+    template <typename Levels>
+    void unlink(Levels& levels, OrderHandle handle);
+
+    bool insert(uint16_t locate, uint64_t ref, char side, uint32_t shares, uint32_t price);
+
+    // Take shares off an order, removing it when nothing is left
+    bool reduce(uint64_t ref, uint32_t shares);
+    void erase(uint64_t ref, OrderHandle handle);
+};
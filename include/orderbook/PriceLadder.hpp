@@ -0,0 +1,283 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <utility>
+#include <vector>
+
+/*
+
+    One side of a symbol's book as a dense ladder of price levels.
+
+    Level storage is an array indexed by (price - base) / tick, with a two level bitmap of the
+    non-empty slots (a summary word over up to 64 words), so finding, adding and removing a level
+    is O(1) and the best or next level is two bit scans. The tick is a cent (100 in ITCH's 1/10000
+    units) for prices of a dollar and up, and 1 below that. Prices off that grid (sub-penny quotes
+    of a dollar stock) and prices too far from the touch for the window go to an ordinary tree.
+    The tick is chosen from the price that lands in an empty window, so a symbol that crosses $1
+    keeps its tick until that side of the book empties out.
+
+    The window starts small and doubles, up to MAX_SLOTS, when a price lands outside it but the
+    occupied range still fits. At the maximum it recentres around the touch and the new price,
+    moving levels that fall out of the window into the tree and pulling back any tree levels that
+    now fall inside. Resizing and recentring allocate; steady state add and remove never do.
+
+    HighestFirst selects the side: bids are best at the highest price, asks at the lowest.
+
+*/
+
+template <typename Level, bool HighestFirst>
+class PriceLadder {
+public:
+    static constexpr size_t MAX_SLOTS = 64 * 64;
+    static constexpr uint32_t PENNY = 100;
+    static constexpr uint32_t PENNY_FLOOR = 10'000;     // $1, the sub-penny rule's cut off
+
+    explicit PriceLadder(size_t initialSlots = 64, size_t maxSlots = MAX_SLOTS)
+        : initialSlots(static_cast<uint32_t>(std::clamp<size_t>(std::bit_ceil(initialSlots), 64, MAX_SLOTS))),
+          maxSlots(static_cast<uint32_t>(std::clamp<size_t>(std::bit_ceil(maxSlots), 64, MAX_SLOTS))) {}
+
+    // The level at price, created empty if there was none
+    Level& level(uint32_t price) {
+        size_t slot;
+        if (inWindow(price, slot)) {
+            if (!occupied(slot)) {
+                mark(slot);
+                slots[slot] = Level{};
+                ++windowCount;
+            }
+            return slots[slot];
+        }
+        return outside(price);
+    }
+
+    Level* find(uint32_t price) {
+        return const_cast<Level*>(std::as_const(*this).find(price));
+    }
+
+    const Level* find(uint32_t price) const {
+        size_t slot;
+        if (inWindow(price, slot)) return occupied(slot) ? &slots[slot] : nullptr;
+        if (overflow.empty()) return nullptr;
+        auto it = overflow.find(price);
+        return it == overflow.end() ? nullptr : &it->second;
+    }
+
+    void erase(uint32_t price) {
+        size_t slot;
+        if (inWindow(price, slot)) {
+            if (occupied(slot)) {
+                unmark(slot);
+                --windowCount;
+            }
+            return;
+        }
+        overflow.erase(price);
+    }
+
+    bool empty() const { return windowCount == 0 && overflow.empty(); }
+    size_t size() const { return windowCount + overflow.size(); }
+
+    // Only meaningful when not empty
+    uint32_t bestPrice() const {
+        if (overflow.empty()) return priceOf(firstSlot());
+        const uint32_t outlier = HighestFirst ? overflow.rbegin()->first : overflow.begin()->first;
+        if (windowCount == 0) return outlier;
+        const uint32_t inside = priceOf(firstSlot());
+        return better(inside, outlier) ? inside : outlier;
+    }
+
+    // Visit levels best first as fn(price, level), stopping early when fn returns false
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        if constexpr (HighestFirst) walk(overflow.rbegin(), overflow.rend(), fn);
+        else walk(overflow.begin(), overflow.end(), fn);
+    }
+
+    size_t windowSlots() const { return slots.size(); }
+    size_t overflowLevels() const { return overflow.size(); }
+    uint64_t recentres() const { return rebuilds; }
+
+private:
+    static constexpr size_t NO_SLOT = SIZE_MAX;
+
+    std::vector<Level> slots;
+    std::vector<uint64_t> words;
+    uint64_t summary = 0;
+    uint32_t base = 0;
+    uint32_t windowCount = 0;
+    uint32_t initialSlots;
+    uint32_t maxSlots;
+    bool penny = false;
+    uint64_t rebuilds = 0;
+    std::map<uint32_t, Level> overflow;
+
+    static bool better(uint32_t a, uint32_t b) { return HighestFirst ? a > b : a < b; }
+
+    uint32_t tick() const { return penny ? PENNY : 1; }
+    uint32_t priceOf(size_t slot) const { return base + static_cast<uint32_t>(slot) * tick(); }
+
+    // Constant divisors so the compiler turns both into multiplies
+    bool inWindow(uint32_t price, size_t& slot) const {
+        if (price < base) return false;
+        const uint32_t offset = price - base;
+        if (penny) {
+            if (offset % PENNY) return false;
+            slot = offset / PENNY;
+        } else {
+            slot = offset;
+        }
+        return slot < slots.size();
+    }
+
+    bool occupied(size_t slot) const { return words[slot >> 6] >> (slot & 63) & 1; }
+
+    void mark(size_t slot) {
+        words[slot >> 6] |= uint64_t(1) << (slot & 63);
+        summary |= uint64_t(1) << (slot >> 6);
+    }
+
+    void unmark(size_t slot) {
+        uint64_t& word = words[slot >> 6];
+        word &= ~(uint64_t(1) << (slot & 63));
+        if (!word) summary &= ~(uint64_t(1) << (slot >> 6));
+    }
+
+    size_t highestSlot() const {
+        const size_t w = 63 - std::countl_zero(summary);
+        return w * 64 + 63 - std::countl_zero(words[w]);
+    }
+
+    size_t lowestSlot() const {
+        const size_t w = std::countr_zero(summary);
+        return w * 64 + std::countr_zero(words[w]);
+    }
+
+    size_t below(size_t slot) const {
+        const size_t w = slot >> 6;
+        const uint64_t rest = words[w] & ((uint64_t(1) << (slot & 63)) - 1);
+        if (rest) return w * 64 + 63 - std::countl_zero(rest);
+        const uint64_t lower = summary & ((uint64_t(1) << w) - 1);
+        if (!lower) return NO_SLOT;
+        const size_t v = 63 - std::countl_zero(lower);
+        return v * 64 + 63 - std::countl_zero(words[v]);
+    }
+
+    size_t above(size_t slot) const {
+        const size_t w = slot >> 6;
+        const size_t b = slot & 63;
+        const uint64_t rest = b == 63 ? 0 : words[w] & (~uint64_t(0) << (b + 1));
+        if (rest) return w * 64 + std::countr_zero(rest);
+        const uint64_t higher = w == 63 ? 0 : summary & (~uint64_t(0) << (w + 1));
+        if (!higher) return NO_SLOT;
+        const size_t v = std::countr_zero(higher);
+        return v * 64 + std::countr_zero(words[v]);
+    }
+
+    size_t firstSlot() const { return HighestFirst ? highestSlot() : lowestSlot(); }
+    size_t nextSlot(size_t slot) const { return HighestFirst ? below(slot) : above(slot); }
+
+    template <typename It, typename Fn>
+    void walk(It it, It end, Fn& fn) const {
+        size_t slot = windowCount ? firstSlot() : NO_SLOT;
+        while (slot != NO_SLOT || it != end) {
+            if (slot != NO_SLOT && (it == end || better(priceOf(slot), it->first))) {
+                if (!fn(priceOf(slot), slots[slot])) return;
+                slot = nextSlot(slot);
+            } else {
+                if (!fn(it->first, it->second)) return;
+                ++it;
+            }
+        }
+    }
+
+    Level& outside(uint32_t price) {
+        auto it = overflow.find(price);
+        if (it != overflow.end()) return it->second;
+
+        size_t slot;
+        if (cover(price) && inWindow(price, slot)) {
+            mark(slot);
+            slots[slot] = Level{};
+            ++windowCount;
+            return slots[slot];
+        }
+        return overflow.try_emplace(price).first->second;
+    }
+
+    // Move or widen the window so it covers price, false if price belongs in the tree
+    bool cover(uint32_t price) {
+        // Nothing to carry over, so the tick can follow the price
+        if (windowCount == 0) penny = price >= PENNY_FLOOR;
+        if (penny && price % PENNY) return false;
+
+        uint32_t lo = price, hi = price;
+        if (windowCount) {
+            lo = std::min(lo, priceOf(lowestSlot()));
+            hi = std::max(hi, priceOf(highestSlot()));
+        }
+
+        size_t size = std::max<size_t>(slots.size(), initialSlots);
+        while ((hi - lo) / tick() >= size && size < maxSlots) size *= 2;
+        if ((hi - lo) / tick() < size) {
+            rebuild(size, lo, hi);
+            return true;
+        }
+
+        // Too wide even at the maximum: follow the touch if price is near it, leave outliers to the tree
+        const uint32_t touch = priceOf(firstSlot());
+        const uint32_t distance = (price > touch ? price - touch : touch - price) / tick();
+        if (distance >= size / 2) return false;
+        rebuild(size, std::min(price, touch), std::max(price, touch));
+        return true;
+    }
+
+    // New window of size slots centred on [lo, hi], anything that doesn't fit goes to the tree
+    void rebuild(size_t size, uint32_t lo, uint32_t hi) {
+        const uint32_t t = tick();
+        const uint32_t slack = static_cast<uint32_t>(size - 1) - (hi - lo) / t;
+        const uint32_t newBase = lo >= slack / 2 * t ? lo - slack / 2 * t : lo % t;
+
+        std::vector<Level> oldSlots = std::move(slots);
+        std::vector<uint64_t> oldWords = std::move(words);
+        const uint32_t oldBase = base;
+
+        slots.assign(size, Level{});
+        words.assign(size / 64, 0);
+        summary = 0;
+        base = newBase;
+        windowCount = 0;
+        ++rebuilds;
+
+        size_t slot;
+        for (size_t w = 0; w < oldWords.size(); ++w) {
+            for (uint64_t bits = oldWords[w]; bits; bits &= bits - 1) {
+                const size_t old = w * 64 + std::countr_zero(bits);
+                const uint32_t price = oldBase + static_cast<uint32_t>(old) * t;
+                if (inWindow(price, slot)) {
+                    slots[slot] = std::move(oldSlots[old]);
+                    mark(slot);
+                    ++windowCount;
+                } else {
+                    overflow.emplace(price, std::move(oldSlots[old]));
+                }
+            }
+        }
+
+        // Tree levels the window now reaches move in, so a price is only ever in one place
+        const uint64_t top = uint64_t(base) + (size - 1) * t;
+        for (auto it = overflow.lower_bound(base); it != overflow.end() && it->first <= top;) {
+            if (inWindow(it->first, slot)) {
+                slots[slot] = std::move(it->second);
+                mark(slot);
+                ++windowCount;
+                it = overflow.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+};
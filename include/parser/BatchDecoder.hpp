@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <functional>
+#include "ItchMessages.hpp"
+
+/*
+
+    Structure-of-arrays decoder for the order flow messages (A, E, X, D, U, P).
+
+    Fields are gathered still big-endian into per-type columns and every column is byte-swapped
+    in one pass by an AVX2 / SSSE3 shuffle kernel picked at runtime, with a scalar fallback.
+    Every row carries the message number so the original order can be rebuilt across types.
+
+*/
+
+namespace ITCH {
+
+    struct OrderColumns {
+        static constexpr size_t CAPACITY = 256;
+
+        msg_type    type;
+        size_t      count;
+
+        alignas(64) uint64_t seq[CAPACITY];          // message number in the source
+        alignas(64) uint64_t timestamps[CAPACITY];
+        alignas(64) uint64_t orderIds[CAPACITY];     // original order id for U
+        alignas(64) uint64_t newOrderIds[CAPACITY];  // U only
+        alignas(64) uint32_t quantities[CAPACITY];   // shares, executed or cancelled shares
+        alignas(64) uint32_t prices[CAPACITY];       // A, U, P
+        alignas(64) uint16_t locates[CAPACITY];
+        alignas(64) char     sides[CAPACITY];        // A, P
+    };
+
+    struct BatchDecodeResult {
+        const char* stop;    // first byte not consumed, always a frame boundary
+        uint64_t    frames;  // frames consumed
+    };
+
+    class BatchDecoder {
+    public:
+        // Called with a full or final column batch of one type
+        using BatchSink = std::function<void(const OrderColumns& batch)>;
+        // Called in stream order for every message that is not batched
+        using OtherSink = std::function<void(uint64_t seq, const char* data)>;
+
+        BatchDecoder(BatchSink onBatch, OtherSink onOther);
+
+        BatchDecoder(const BatchDecoder& other) = delete;
+        BatchDecoder& operator=(const BatchDecoder& other) = delete;
+
+        // Decode every complete frame in [begin, end). Pending batches are flushed before returning.
+        BatchDecodeResult decode(const char* begin, const char* end, uint64_t firstSeq = 0);
+
+        // Name of the byte swap kernel selected for this CPU
+        static const char* kernelName();
+
+    private:
+        static constexpr std::array<msg_type, 6> BATCHED_TYPES = {
+            AddOrderMsgType, OrderExecutedMsgType, OrderCancelMsgType,
+            OrderDeleteMsgType, OrderReplaceMsgType, TradeMsgType
+        };
+
+        BatchSink onBatch;
+        OtherSink onOther;
+
+        std::array<OrderColumns, BATCHED_TYPES.size()> batches;
+
+        // Batched type byte -> index into batches, -1 for scalar types
+        std::array<int8_t, 256> slotOf;
+
+        void gather(OrderColumns& batch, const char* data, uint64_t seq);
+        void flush(OrderColumns& batch);
+    };
+
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "MoldUdp64.hpp"
+
+/*
+
+    Sequence gap detection and retransmission for a MoldUDP64 feed.
+
+    Packets that arrive ahead of the expected sequence are parked in a bounded hold buffer while
+    the missing range is requested from a rerequest server. Reception never blocks on the gap:
+    live packets keep being held, and if the hold buffer fills or the retries run out the gap is
+    abandoned and delivery resumes from the oldest held packet.
+
+*/
+
+namespace ITCH {
+
+    struct RecoveryConfig {
+        size_t   holdPackets = 256;           // packets parked while a gap is open
+        uint64_t retryTimeoutNs = 5'000'000;  // re-request if nothing filled the gap for this long
+        uint32_t maxRetries = 3;
+        uint16_t maxRequestCount = 4096;      // messages asked for per request
+    };
+
+    struct RecoveryStats {
+        uint64_t gapsDetected = 0;
+        uint64_t gapsRecovered = 0;
+        uint64_t gapsAbandoned = 0;
+        uint64_t messagesRecovered = 0;   // delivered from retransmissions
+        uint64_t messagesLost = 0;        // skipped when a gap was abandoned
+        uint64_t requestsSent = 0;
+        uint64_t heldPackets = 0;         // currently parked
+        uint64_t maxHeldPackets = 0;
+        uint64_t holdOverflows = 0;
+        uint64_t lastRecoveryNs = 0;      // detection to gap filled
+        uint64_t maxRecoveryNs = 0;
+        uint64_t totalRecoveryNs = 0;
+    };
+
+    class GapRecovery {
+    public:
+        GapRecovery() = delete;
+
+        GapRecovery(MoldUdp64Session& session, const char* serverHost, uint16_t serverPort,
+                    const RecoveryConfig& config = {});
+
+        GapRecovery(const GapRecovery& other) = delete;
+        GapRecovery& operator=(const GapRecovery& other) = delete;
+
+        ~GapRecovery();
+
+        // Feed one live packet
+        void onPacket(const char* data, size_t len);
+
+        // Drain retransmissions without blocking and handle request timeouts, call from the receive loop
+        void service();
+
+        // Receive from the live socket and service recovery until running goes false or the session ends
+        void run(UdpReader& live, const std::atomic<bool>& running);
+
+        // Receive thread only
+        bool inGap() const { return gapOpen; }
+        bool endOfSession() const { return sessionEnded; }
+
+        // Snapshot of the counters, safe from any thread while the receive loop runs
+        RecoveryStats stats() const;
+
+    private:
+        struct HeldPacket {
+            uint64_t seq;
+            uint16_t count;
+            uint16_t len;
+            bool     used;
+            char     data[2048];
+        };
+
+        MoldUdp64Session& session;
+        RecoveryConfig config;
+        int fd;
+        // Only the receive thread writes these (load then store), stats() reads them from anywhere
+        struct Counters {
+            std::atomic<uint64_t> gapsDetected{0};
+            std::atomic<uint64_t> gapsRecovered{0};
+            std::atomic<uint64_t> gapsAbandoned{0};
+            std::atomic<uint64_t> messagesRecovered{0};
+            std::atomic<uint64_t> messagesLost{0};
+            std::atomic<uint64_t> requestsSent{0};
+            std::atomic<uint64_t> heldPackets{0};
+            std::atomic<uint64_t> maxHeldPackets{0};
+            std::atomic<uint64_t> holdOverflows{0};
+            std::atomic<uint64_t> lastRecoveryNs{0};
+            std::atomic<uint64_t> maxRecoveryNs{0};
+            std::atomic<uint64_t> totalRecoveryNs{0};
+        };
+
+        std::vector<HeldPacket> held;
+        size_t parked = 0;            // used slots in held
+        Counters counters;
+        char sessionName[MOLD_SESSION_SIZE] = {};
+
+        bool gapOpen = false;
+        bool sessionEnded = false;
+        uint64_t gapEnd = 0;          // first sequence known to exist past the gap
+        uint64_t gapStartTsc = 0;
+        uint64_t lastRequestTsc = 0;
+        uint32_t retries = 0;
+
+        void handle(const char* data, size_t len, bool retransmission);
+        bool hold(const MoldHeader& header, const char* data, size_t len);
+        void drain();
+        void openGap();
+        void request();
+        void abandon();
+        void closeGapIfFilled();
+        void reopenIfHeld();
+    };
+
+    // Stand-in for the exchange's rerequest server, serves sequence ranges out of an ITCH file
+    class RerequestServer {
+    public:
+        RerequestServer() = delete;
+
+        // port 0 binds an ephemeral port, see port()
+        explicit RerequestServer(const char* itchFile, uint16_t port = 0, std::string_view session = "EXCELSIOR0");
+
+        RerequestServer(const RerequestServer& other) = delete;
+        RerequestServer& operator=(const RerequestServer& other) = delete;
+
+        ~RerequestServer();
+
+        void start();
+        void stop();
+
+        uint16_t port() const { return boundPort; }
+        uint64_t requestsServed() const { return served.load(std::memory_order_relaxed); }
+
+    private:
+        MmapReader reader;
+        std::vector<const char*> messages;  // message number 1 is messages[0]
+        int fd;
+        uint16_t boundPort;
+        MoldPacketBuilder builder;
+        std::atomic<bool> running{false};
+        std::atomic<uint64_t> served{0};
+        std::thread worker;
+
+        void serve();
+    };
+
+}
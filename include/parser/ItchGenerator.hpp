@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <queue>
+#include <vector>
+#include "ItchMessages.hpp"
+
+/*
+
+    Deterministic synthetic ITCH 5.0 feed for benchmarks and tests.
+
+    A session looks like a trading day: system events, a stock directory with trading actions,
+    Reg SHO and market maker registrations, then order flow with the admin and auction messages
+    sprinkled in, then the closing system events. All 23 message types appear. Symbol activity is
+    Zipf distributed and orders live for a mixture of very short (most adds are cancelled within
+    a few dozen messages), intraday and all-day lifetimes.
+
+    The same config always produces byte identical output: the generator uses its own PRNG and
+    distributions, nothing from <random>, so results do not depend on the standard library.
+
+*/
+
+namespace ITCH {
+
+    struct GeneratorConfig {
+        uint64_t seed = 1;
+        uint64_t messages = 10'000'000;     // total frames including the directory
+        uint32_t symbols = 8000;
+        double   symbolSkew = 1.0;          // Zipf exponent of per-symbol activity
+        double   shortLived = 0.70;         // share of orders that end within shortLifetime messages
+        double   longLived = 0.05;          // share that rest until the close, the rest live intraday
+        uint64_t shortLifetime = 40;        // mean lifetime in messages
+        uint64_t intradayLifetime = 20'000;
+    };
+
+    struct GeneratorStats {
+        uint64_t messages = 0;
+        uint64_t bytes = 0;                 // framed size, length prefixes included
+        uint64_t ordersAdded = 0;
+        uint64_t ordersOpenAtEnd = 0;
+        std::array<uint64_t, 256> perType{};
+    };
+
+    class ItchGenerator {
+    public:
+        explicit ItchGenerator(const GeneratorConfig& config = {});
+
+        // Generate the whole session as length prefixed frames, the layout of a flat ITCH file
+        std::vector<char> generate();
+
+        // Generate into a file, returns what was written
+        GeneratorStats writeFile(const char* path);
+
+        const GeneratorStats& stats() const { return counters; }
+
+    private:
+        struct Symbol {
+            char     ticker[8];
+            uint32_t mid;           // 1/10000 dollars
+            uint32_t tick;
+        };
+
+        struct Order {
+            uint64_t ref;
+            uint64_t due;           // message number at which its fate is decided
+            uint32_t price;
+            uint32_t shares;
+            uint16_t locate;
+            char     side;
+            bool     attributed;
+        };
+
+        struct Later {
+            bool operator()(const Order& a, const Order& b) const { return a.due > b.due; }
+        };
+
+        GeneratorConfig config;
+        GeneratorStats counters;
+        std::vector<Symbol> symbols;
+        std::vector<double> symbolCdf;
+        std::priority_queue<Order, std::vector<Order>, Later> live;
+        std::vector<char>* out = nullptr;
+
+        uint64_t state;
+        uint64_t timestamp;
+        uint64_t meanGapNs;
+        uint64_t nextOrderRef = 1;
+        uint64_t nextMatch = 1;
+        uint64_t lastTrade = 0;
+
+        // PRNG and the distributions built on it
+        uint64_t nextU64();
+        double uniform();
+        uint64_t below(uint64_t n);
+        uint64_t exponential(double mean);
+        uint16_t pickSymbol();
+
+        void setupSymbols();
+        void directory();
+        void orderFlow(uint64_t budget);
+        void closing();
+
+        uint64_t lifetime();
+        uint32_t quotePrice(const Symbol& s, char side);
+        void addOrder(uint16_t locate);
+        void pushLive(const Order& o);
+        void finish(Order order);
+        void admin(uint16_t locate);
+
+        // Frame writers, one per type
+        char* frame(msg_type type, uint16_t locate);
+        void systemEvent(char code);
+        void stockDirectory(uint16_t locate);
+        void tradingAction(uint16_t locate, char state);
+        void regSho(uint16_t locate);
+        void participantPosition(uint16_t locate);
+        void mwcbDecline();
+        void mwcbStatus();
+        void ipoUpdate(uint16_t locate);
+        void luldCollar(uint16_t locate);
+        void operationalHalt(uint16_t locate);
+        void add(const Order& o);
+        void executed(const Order& o, uint32_t shares);
+        void executedWithPrice(const Order& o, uint32_t shares, uint32_t price);
+        void cancel(const Order& o, uint32_t shares);
+        void remove(const Order& o);
+        void replace(const Order& o, const Order& replacement);
+        void trade(uint16_t locate);
+        void crossTrade(uint16_t locate);
+        void brokenTrade(uint16_t locate);
+        void noii(uint16_t locate);
+        void retailInterest(uint16_t locate);
+        void directListing(uint16_t locate);
+    };
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "ItchMessages.hpp"
+
+/*
+
+    Sidecar index of (message number, timestamp, byte offset) checkpoints for an ITCH file.
+    Lets MmapReader start parsing at a message number or timestamp without walking from byte 0.
+
+*/
+
+namespace ITCH {
+
+    class MmapReader;
+
+    struct IndexEntry {
+        uint64_t    msgNumber;  // zero based message number of the checkpoint
+        uint64_t    timestamp;  // nanoseconds since midnight of the checkpoint message
+        uint64_t    offset;     // byte offset of the checkpoint's length prefix
+    };
+
+    struct IndexHeader {
+        char        magic[8];
+        uint32_t    version;
+        uint32_t    stride;     // messages between checkpoints
+        uint64_t    fileSize;   // size of the indexed ITCH file, guards against stale sidecars
+        uint64_t    msgCount;   // total messages in the indexed file
+        uint64_t    entryCount;
+    };
+
+    class OffsetIndex {
+    public:
+        static constexpr char     MAGIC[8] = {'E', 'X', 'C', 'I', 'D', 'X', '\0', '\0'};
+        static constexpr uint32_t VERSION = 1;
+        static constexpr uint32_t DEFAULT_STRIDE = 4096;
+
+        OffsetIndex() = delete;
+
+        // Map an existing sidecar file
+        explicit OffsetIndex(const char* indexFile);
+
+        OffsetIndex(const OffsetIndex& other) = delete;
+        OffsetIndex& operator=(const OffsetIndex& other) = delete;
+
+        ~OffsetIndex();
+
+        // Walk the whole ITCH file once and write a checkpoint every stride messages
+        static void build(const char* itchFile, const char* indexFile, uint32_t stride = DEFAULT_STRIDE);
+
+        // Conventional sidecar location, "<itchFile>.idx"
+        static std::string sidecarPath(const char* itchFile);
+
+        // Last checkpoint at or before msgNumber
+        const IndexEntry& atMessage(uint64_t msgNumber) const;
+
+        // Last checkpoint strictly before timestamp, so no message at the timestamp is skipped
+        const IndexEntry& atTimestamp(ts timestamp) const;
+
+        uint32_t stride() const { return header->stride; }
+        uint64_t fileSize() const { return header->fileSize; }
+        uint64_t msgCount() const { return header->msgCount; }
+        size_t   size() const { return header->entryCount; }
+
+    private:
+        int fd;
+        char* start;
+        size_t length;
+        const IndexHeader* header;
+        const IndexEntry* entries;
+    };
+
+}
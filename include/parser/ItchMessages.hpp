@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <initializer_list>
 #include <cstddef>
 #include <cstdint>
 
@@ -361,8 +363,8 @@ namespace ITCH {
     template <> constexpr uint16_t MsgSize<AddOrderMsgType>                = 36;
     template <> constexpr uint16_t MsgSize<AddOrderMPIDAttributionMsgType> = 40;
 
-    template <> constexpr uint16_t MsgSize<OrderExecutedMsgType>           = 23;
-    template <> constexpr uint16_t MsgSize<OrderExecutedWithPriceMsgType>  = 27;
+    template <> constexpr uint16_t MsgSize<OrderExecutedMsgType>           = 31;
+    template <> constexpr uint16_t MsgSize<OrderExecutedWithPriceMsgType>  = 36;
 
     template <> constexpr uint16_t MsgSize<OrderCancelMsgType>             = 23;
     template <> constexpr uint16_t MsgSize<OrderDeleteMsgType>             = 19;
@@ -370,7 +372,7 @@ namespace ITCH {
 
     template <> constexpr uint16_t MsgSize<TradeMsgType>                   = 44;
 
-    template <> constexpr uint16_t MsgSize<CrossTradeMsgType>              = 39;
+    template <> constexpr uint16_t MsgSize<CrossTradeMsgType>              = 40;
     template <> constexpr uint16_t MsgSize<BrokenTradeMsgType>             = 19;
 
     template <> constexpr uint16_t MsgSize<SystemEventMsgType>             = 12;
@@ -390,4 +392,70 @@ namespace ITCH {
     template <> constexpr uint16_t MsgSize<RetailInterestMsgType>          = 20;
     template <> constexpr uint16_t MsgSize<DirectListingWithCRPDMsgType>   = 48;
 
-}
\ No newline at end of file
+    // Wire size lookup by runtime type byte, 0 for unknown types. Used to validate frames when
+    // resynchronising on message boundaries in the middle of a file.
+
+    inline constexpr std::array<uint16_t, 256> MsgSizeTable = [] {
+        std::array<uint16_t, 256> t{};
+        t[static_cast<uint8_t>(SystemEventMsgType)]               = MsgSize<SystemEventMsgType>;
+        t[static_cast<uint8_t>(StockDirectoryMsgType)]            = MsgSize<StockDirectoryMsgType>;
+        t[static_cast<uint8_t>(StockTradingActionMsgType)]        = MsgSize<StockTradingActionMsgType>;
+        t[static_cast<uint8_t>(RegSHORestrictionMsgType)]         = MsgSize<RegSHORestrictionMsgType>;
+        t[static_cast<uint8_t>(MarketParticipantPositionMsgType)] = MsgSize<MarketParticipantPositionMsgType>;
+        t[static_cast<uint8_t>(MWCBDeclineLevelMsgType)]          = MsgSize<MWCBDeclineLevelMsgType>;
+        t[static_cast<uint8_t>(MWCBStatusMsgType)]                = MsgSize<MWCBStatusMsgType>;
+        t[static_cast<uint8_t>(IPOQuotingPeriodUpdateMsgType)]    = MsgSize<IPOQuotingPeriodUpdateMsgType>;
+        t[static_cast<uint8_t>(LULDAuctionCollarMsgType)]         = MsgSize<LULDAuctionCollarMsgType>;
+        t[static_cast<uint8_t>(OperationalHaltMsgType)]           = MsgSize<OperationalHaltMsgType>;
+        t[static_cast<uint8_t>(AddOrderMsgType)]                  = MsgSize<AddOrderMsgType>;
+        t[static_cast<uint8_t>(AddOrderMPIDAttributionMsgType)]   = MsgSize<AddOrderMPIDAttributionMsgType>;
+        t[static_cast<uint8_t>(OrderExecutedMsgType)]             = MsgSize<OrderExecutedMsgType>;
+        t[static_cast<uint8_t>(OrderExecutedWithPriceMsgType)]    = MsgSize<OrderExecutedWithPriceMsgType>;
+        t[static_cast<uint8_t>(OrderCancelMsgType)]               = MsgSize<OrderCancelMsgType>;
+        t[static_cast<uint8_t>(OrderDeleteMsgType)]               = MsgSize<OrderDeleteMsgType>;
+        t[static_cast<uint8_t>(OrderReplaceMsgType)]              = MsgSize<OrderReplaceMsgType>;
+        t[static_cast<uint8_t>(TradeMsgType)]                     = MsgSize<TradeMsgType>;
+        t[static_cast<uint8_t>(CrossTradeMsgType)]                = MsgSize<CrossTradeMsgType>;
+        t[static_cast<uint8_t>(BrokenTradeMsgType)]               = MsgSize<BrokenTradeMsgType>;
+        t[static_cast<uint8_t>(NOIIMessageMsgType)]               = MsgSize<NOIIMessageMsgType>;
+        t[static_cast<uint8_t>(RetailInterestMsgType)]            = MsgSize<RetailInterestMsgType>;
+        t[static_cast<uint8_t>(DirectListingWithCRPDMsgType)]     = MsgSize<DirectListingWithCRPDMsgType>;
+        return t;
+    }();
+
+    // Set of message types, indexed by the type byte
+
+    class TypeMask {
+    public:
+        constexpr TypeMask() = default;
+
+        constexpr TypeMask(std::initializer_list<msg_type> types) {
+            for (msg_type t : types) set(t);
+        }
+
+        // Every type with a known wire size
+        static constexpr TypeMask all() {
+            TypeMask m;
+            for (size_t t = 0; t < MsgSizeTable.size(); ++t) {
+                if (MsgSizeTable[t]) m.set(static_cast<msg_type>(t));
+            }
+            return m;
+        }
+
+        constexpr void set(msg_type t) { bits[index(t) >> 6] |= uint64_t(1) << (index(t) & 63); }
+        constexpr void reset(msg_type t) { bits[index(t) >> 6] &= ~(uint64_t(1) << (index(t) & 63)); }
+        constexpr bool test(msg_type t) const { return bits[index(t) >> 6] >> (index(t) & 63) & 1; }
+
+    private:
+        std::array<uint64_t, 4> bits{};
+
+        static constexpr uint8_t index(msg_type t) { return static_cast<uint8_t>(t); }
+    };
+
+    // What a book builder needs once the directory has been loaded
+    inline constexpr TypeMask OrderFlowTypes {
+        AddOrderMsgType, AddOrderMPIDAttributionMsgType, OrderExecutedMsgType, OrderExecutedWithPriceMsgType,
+        OrderCancelMsgType, OrderDeleteMsgType, OrderReplaceMsgType, TradeMsgType
+    };
+
+}
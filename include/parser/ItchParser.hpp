@@ -7,12 +7,61 @@
 #include <cstring> 
 #include <memory>
 #include <array>
+#include <vector>
+#include <functional>
 #include "ItchMessages.hpp"
+#include "ItchIndex.hpp"
+#include "ItchViews.hpp"
 #include "../../src/utils/SpmcRingBuffer.cpp"
+#include "../../src/utils/ShardedQueue.cpp"
+#include "../../src/utils/ByteRing.cpp"
+#include "../../src/utils/TscClock.cpp"
+#include "../../src/utils/LatencyStats.cpp"
 
 namespace ITCH {
 
+    struct MsgEnvelope;
+    class BatchDecoder;
+
+    // What emitToBuffer puts on the ring
+    enum class PublishMode : uint8_t {
+        Decoded,    // host order message struct, the default
+        RawBytes,   // the wire bytes, read through the views in ItchViews.hpp
+        Reference   // a FrameRef pointing into the mapping, valid while the reader is alive and
+                    // only in this process, so a shared memory or memfd buffer is refused
+    };
+
     using DispatchTableEntry = void(*)(const char*);
+    using DispatchTable = std::array<DispatchTableEntry, 256>;
+    using DecodeTableEntry = void(*)(const char*, MsgEnvelope&);
+
+    struct ReplayConfig {
+        double   speed = 1.0;                // 1 = as recorded, N = N times faster, 0 = unthrottled
+        ts       startTimestamp = 0;         // messages before this are skipped, not published
+        ts       stopTimestamp = UINT64_MAX; // replay stops at the first message at or after this
+        uint64_t lateThresholdNs = 1000;     // publishing later than this behind schedule counts as late
+    };
+
+    struct ReplayStats {
+        uint64_t messages = 0;
+        uint64_t lateMessages = 0;
+        uint64_t maxBehindNs = 0;    // worst lag behind the schedule
+        uint64_t totalBehindNs = 0;  // sum of lags, divide by messages for the mean
+        uint64_t finalBehindNs = 0;  // lag of the last message published
+        uint64_t wallNs = 0;
+    };
+
+    // A slice of the mapping that starts and ends on real message boundaries
+    struct ParseRange {
+        const char* begin;
+        const char* end;
+        uint64_t    firstSeq;  // global message number of the first frame in the range
+        uint64_t    count;     // number of frames in the range
+    };
+
+    // Receives decoded messages from one range, called on that range's worker thread.
+    // Within a range seq is strictly increasing, across ranges it gives the original file order.
+    using RangeSink = std::function<void(size_t range, uint64_t seq, const MsgEnvelope& msg)>;
 
     class MmapReader {
     public:
@@ -30,23 +79,113 @@ namespace ITCH {
 
         void parse();
 
-        static void setBuffer(SPMC_Queue* buf) { buffer_ = buf; }
+        // Decode the rest of the mapping in structure-of-arrays batches instead of one message at a time
+        void parseBatched(BatchDecoder& decoder);
+
+        // Parse from the cursor up to, but not including, the first message at or after stop
+        void parseUntil(ts stop);
+
+        // Publish from the cursor paced by the ITCH timestamps, see ReplayConfig. With an index
+        // the start timestamp is reached by seeking instead of walking from the cursor.
+        ReplayStats replay(const ReplayConfig& config, const OffsetIndex* index = nullptr);
+
+        // Position the cursor at a message number or at the first message at or after a timestamp,
+        // starting from the nearest checkpoint in the sidecar index. Returns false past the end.
+        bool seekToMessage(const OffsetIndex& index, uint64_t msgNumber);
+        bool seekToTimestamp(const OffsetIndex& index, ts timestamp);
+        void rewind();
+
+        // Byte offset and message number of the next message nextMsg() will return
+        uint64_t offset() const { return cursor - start; }
+        uint64_t messageNumber() const { return msgNumber; }
+        uint64_t size() const { return end - start; }
+
+        static ts getDataTimestamp(char const* data);
+
+        // Split the mapping into numRanges ranges on message boundaries and number their messages
+        std::vector<ParseRange> splitRanges(size_t numRanges) const;
+
+        // Decode each range on its own thread. parse() remains the single threaded reference path.
+        void parseParallel(size_t numThreads, const RangeSink& sink) const;
+
+        // With EXCELSIOR_LATENCY the stamps of every message published into buf go to a side channel
+        static void setBuffer(SPMC_Queue* buf) {
+            buffer_ = buf;
+            LATENCY_PROBE(if (buf) LatencyProbe::track(buf->size()));
+        }
+
+        // Route by stock locate into per-shard queues instead of the single buffer, nullptr to undo
+        static void setShardedBuffer(ShardedQueue* shards) { shards_ = shards; }
+
+        // Pack messages back to back into a variable length ring instead of one Block each,
+        // pairs best with PublishMode::RawBytes. nullptr to go back to the buffer.
+        static void setByteRing(ByteRing* ring) { byteRing_ = ring; }
+
+        // Publish every n messages with one release store instead of one per message. parse and
+        // parseUntil flush at the end, other sources call flushPublished at their own boundaries.
+        static void setPublishBatch(uint32_t n) { publishBatch_ = n ? n : 1; }
+        static void flushPublished();
+
+        // Switch what each message publishes, rebuilds the dispatch table. Reference with a
+        // queue from createShared / createMemfd throws here or when parsing starts.
+        void setPublishMode(PublishMode mode);
+        PublishMode publishMode() const { return mode; }
+
+        // Only decode and publish these types, everything else gets a no-op dispatch entry.
+        // Not thread safe against a running parse, call it between parse calls (e.g. after
+        // parseUntil has loaded the directory).
+        void subscribe(const TypeMask& types);
+        const TypeMask& subscription() const { return subscribed; }
+
+        // The table parse() uses, for readers of other sources that publish the same way
+        static DispatchTable makeDispatchTable(PublishMode mode, const TypeMask& types);
 
     private:
         int fd;
         char* start;
         char* cursor;
         char* end;  
+        uint64_t msgNumber;
+        PublishMode mode = PublishMode::Decoded;
+        TypeMask subscribed = TypeMask::all();
         static SPMC_Queue* buffer_;
+        inline static ShardedQueue* shards_ = nullptr;
+        inline static ByteRing* byteRing_ = nullptr;
+        inline static uint32_t publishBatch_ = 1;
+        inline static uint32_t staged_ = 0;
 
         // Avoid branchy code in parse
-        std::array<DispatchTableEntry, 256> dispatchTable = {};
+        DispatchTable dispatchTable = {};
+        std::array<DecodeTableEntry, 256> decodeTable = {};
 
-        void initDispatchTable();
+        static void initDispatchTable(DispatchTable& table, PublishMode mode);
+        void initDecodeTable();
+        void rebuildTables();
+        static void checkPublishTarget(PublishMode mode);
+
+        static void skipMsg(const char*) {}
+
+        // Type, locate, tracking number and 48-bit timestamp common to every message
+        static constexpr size_t MSG_HEADER_SIZE = 11;
+
+        // Number of consecutive well formed frames required to accept a resync point
+        static constexpr size_t RESYNC_FRAMES = 16;
+
+        const char* findFrameBoundary(const char* from) const;
+        bool isFrameChain(const char* p, size_t frames) const;
+
+        template <auto Construct, msg_type Type>
+        static void decodeInto(const char* data, MsgEnvelope& env);
 
         template <typename MsgEnvelope>
         static void emitToBuffer(const MsgEnvelope& msg, msg_type type);
 
+        template <typename Fn>
+        static void publish(uint16_t locate, PayloadSize size, Fn&& write);
+
+        static void emitRawBytes(const char* data);
+        static void emitFrameRef(const char* data);
+
         static SystemEventMsg                         constructSystemEventMsg(char const* data);
         static StockDirectoryMsg                      constructStockDirectoryMsg(char const* data);
         static StockTradingActionMsg                  constructStockTradingActionMsg(char const* data);
@@ -71,9 +210,8 @@ namespace ITCH {
         static RetailInterestMsg                      constructRetailInterestMsg(char const* data);
         static DirectListingWithCRPDMsg               constructDirectListingWithCRPDMsg(char const* data);
 
-        ts getDataTimestamp(char const* data);
         ts strToTimestamp(char const* timestampStr);
-        msg_type getDataMessageType(char const* data);
+        static msg_type getDataMessageType(char const* data);
     };
 
     struct MsgEnvelope {
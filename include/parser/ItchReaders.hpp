@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <endian.h>
+
+/*
+
+    Big-endian field readers for ITCH wire data, shared by the decoders and the lazy views.
+
+*/
+
+namespace ITCH {
+
+    inline constexpr uint8_t readU8(const char* data, size_t offset) {
+        return *reinterpret_cast<const uint8_t*>(data + offset);
+    }
+
+    inline constexpr char readChar(const char* data, size_t offset) {
+        return static_cast<char>(readU8(data, offset));
+    }
+
+    inline uint16_t readU16(const char* data, size_t offset) {
+        return be16toh(*reinterpret_cast<const uint16_t*>(data + offset));
+    }
+
+    inline uint32_t readU32(const char* data, size_t offset) {
+        return be32toh(*reinterpret_cast<const uint32_t*>(data + offset));
+    }
+
+    inline uint64_t readU48(const char* d, size_t off) {
+        return (uint64_t(readU16(d, off)) << 32) | readU32(d, off + 2);
+    }
+
+    inline uint64_t readU64(const char* data, size_t offset) {
+        return be64toh(*reinterpret_cast<const uint64_t*>(data + offset));
+    }
+
+    inline void copyBytes(void* dst, const char* data, size_t offset, size_t len) {
+        std::memcpy(dst, data + offset, len);
+    }
+
+}
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include "ItchMessages.hpp"
+#include "ItchReaders.hpp"
+
+/*
+
+    Lazily decoded views over raw ITCH wire bytes.
+
+    Used with the RawBytes and Reference publish modes: nothing is decoded until a field is
+    asked for, and only that field is byte-swapped. Offsets follow the ITCH 5.0 wire layout.
+
+*/
+
+namespace ITCH {
+
+    // What the Reference publish mode puts on the ring, the frame stays in the mapped file
+    struct FrameRef {
+        const char* data;
+        uint16_t    length;
+        msg_type    type;
+    };
+
+    class FrameView {
+    public:
+        explicit FrameView(const char* data) : data(data) {}
+
+        msg_type    msgType() const { return readChar(data, 0); }
+        uint16_t    securityNameIdx() const { return readU16(data, 1); }
+        uint16_t    seqNumber() const { return readU16(data, 3); }
+        ts          timestamp() const { return readU48(data, 5); }
+        const char* raw() const { return data; }
+
+    protected:
+        const char* data;
+
+        std::string_view chars(size_t offset, size_t len) const { return {data + offset, len}; }
+    };
+
+    class SystemEventView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        uint8_t eventCode() const { return readU8(data, 11); }
+    };
+
+    class StockDirectoryView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        std::string_view ticker() const { return chars(11, 8); }
+        uint8_t  marketCategory() const { return readU8(data, 19); }
+        uint8_t  financialStatusIndicator() const { return readU8(data, 20); }
+        uint32_t roundLotSize() const { return readU32(data, 21); }
+        uint8_t  roundLotsOnly() const { return readU8(data, 25); }
+        uint8_t  securityClass() const { return readU8(data, 26); }
+        std::string_view issueSubType() const { return chars(27, 2); }
+        uint8_t  authenticity() const { return readU8(data, 29); }
+        uint8_t  shortSaleThresholdIndicator() const { return readU8(data, 30); }
+        uint8_t  IPOFlag() const { return readU8(data, 31); }
+        uint8_t  LULDReferencePriceTier() const { return readU8(data, 32); }
+        uint8_t  ETPFlag() const { return readU8(data, 33); }
+        uint32_t ETPLeverageFactor() const { return readU32(data, 34); }
+        uint8_t  inverseIndicator() const { return readU8(data, 38); }
+    };
+
+    class StockTradingActionView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        std::string_view ticker() const { return chars(11, 8); }
+        uint8_t  tradingState() const { return readU8(data, 19); }
+        uint8_t  reserved() const { return readU8(data, 20); }
+        std::string_view reason() const { return chars(21, 4); }
+    };
+
+    class RegSHORestrictionView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        std::string_view ticker() const { return chars(11, 8); }
+        uint8_t  RegSHOAction() const { return readU8(data, 19); }
+    };
+
+    class MarketParticipantPositionView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        std::string_view MPID() const { return chars(11, 4); }
+        std::string_view ticker() const { return chars(15, 8); }
+        uint8_t  primaryMarketMaker() const { return readU8(data, 23); }
+        uint8_t  marketMakerMode() const { return readU8(data, 24); }
+        uint8_t  marketParticipantState() const { return readU8(data, 25); }
+    };
+
+    class MWCBDeclineLevelView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        uint64_t level1() const { return readU64(data, 11); }
+        uint64_t level2() const { return readU64(data, 19); }
+        uint64_t level3() const { return readU64(data, 27); }
+    };
+
+    class MWCBStatusView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        uint8_t  breachedLevel() const { return readU8(data, 11); }
+    };
+
+    class IPOQuotingPeriodUpdateView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        std::string_view ticker() const { return chars(11, 8); }
+        uint32_t ipoQuotationReleaseTime() const { return readU32(data, 19); }
+        uint8_t  ipoQuotationReleaseQualifier() const { return readU8(data, 23); }
+        uint32_t ipoPrice() const { return readU32(data, 24); }
+    };
+
+    class LULDAuctionCollarView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        std::string_view ticker() const { return chars(11, 8); }
+        uint32_t auctionCollarRefPrice() const { return readU32(data, 19); }
+        uint32_t upperAuctionCollarPrice() const { return readU32(data, 23); }
+        uint32_t lowerAuctionCollarPrice() const { return readU32(data, 27); }
+        uint32_t auctionCollarExtension() const { return readU32(data, 31); }
+    };
+
+    class OperationalHaltView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        std::string_view ticker() const { return chars(11, 8); }
+        uint8_t  marketCode() const { return readU8(data, 19); }
+        uint8_t  operationalHaltAction() const { return readU8(data, 20); }
+    };
+
+    class AddOrderView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        uint64_t orderId() const { return readU64(data, 11); }
+        char     side() const { return readChar(data, 19); }
+        uint32_t quantity() const { return readU32(data, 20); }
+        std::string_view ticker() const { return chars(24, 8); }
+        uint32_t price() const { return readU32(data, 32); }
+    };
+
+    class AddOrderMPIDAttributionView : public AddOrderView {
+    public:
+        using AddOrderView::AddOrderView;
+        std::string_view MPID() const { return chars(36, 4); }
+    };
+
+    class OrderExecutedView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        uint64_t orderId() const { return readU64(data, 11); }
+        uint32_t executedQuantity() const { return readU32(data, 19); }
+        uint64_t matchId() const { return readU64(data, 23); }
+    };
+
+    class OrderExecutedWithPriceView : public OrderExecutedView {
+    public:
+        using OrderExecutedView::OrderExecutedView;
+        char     printable() const { return readChar(data, 31); }
+        uint32_t executedPrice() const { return readU32(data, 32); }
+    };
+
+    class OrderCancelView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        uint64_t orderId() const { return readU64(data, 11); }
+        uint32_t cancelledQuantity() const { return readU32(data, 19); }
+    };
+
+    class OrderDeleteView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        uint64_t orderId() const { return readU64(data, 11); }
+    };
+
+    class OrderReplaceView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        uint64_t ogOrderId() const { return readU64(data, 11); }
+        uint64_t newOrderId() const { return readU64(data, 19); }
+        uint32_t quantity() const { return readU32(data, 27); }
+        uint32_t price() const { return readU32(data, 31); }
+    };
+
+    class TradeView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        uint64_t orderId() const { return readU64(data, 11); }
+        char     side() const { return readChar(data, 19); }
+        uint32_t quantity() const { return readU32(data, 20); }
+        std::string_view ticker() const { return chars(24, 8); }
+        uint32_t price() const { return readU32(data, 32); }
+        uint64_t matchId() const { return readU64(data, 36); }
+    };
+
+    class CrossTradeView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        uint64_t quantity() const { return readU64(data, 11); }
+        std::string_view ticker() const { return chars(19, 8); }
+        uint32_t crossPrice() const { return readU32(data, 27); }
+        uint64_t matchId() const { return readU64(data, 31); }
+        char     crossType() const { return readChar(data, 39); }
+    };
+
+    class BrokenTradeView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        uint64_t matchId() const { return readU64(data, 11); }
+    };
+
+    class NOIIView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        uint64_t pairedShares() const { return readU64(data, 11); }
+        uint64_t imbalanceShares() const { return readU64(data, 19); }
+        uint8_t  imbalanceDirection() const { return readU8(data, 27); }
+        std::string_view ticker() const { return chars(28, 8); }
+        uint32_t farPrice() const { return readU32(data, 36); }
+        uint32_t nearPrice() const { return readU32(data, 40); }
+        uint32_t currentRefPrice() const { return readU32(data, 44); }
+        uint8_t  crossType() const { return readU8(data, 48); }
+        uint8_t  priceVariationIndicator() const { return readU8(data, 49); }
+    };
+
+    class RetailInterestView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        std::string_view ticker() const { return chars(11, 8); }
+        uint8_t  interestFlag() const { return readU8(data, 19); }
+    };
+
+    class DirectListingWithCRPDView : public FrameView {
+    public:
+        using FrameView::FrameView;
+        std::string_view ticker() const { return chars(11, 8); }
+        uint8_t  openEligibilityStatus() const { return readU8(data, 19); }
+        uint32_t minAllowablePrice() const { return readU32(data, 20); }
+        uint32_t maxAllowablePrice() const { return readU32(data, 24); }
+        uint32_t nearExecutionPrice() const { return readU32(data, 28); }
+        uint64_t nearExecutionTime() const { return readU64(data, 32); }
+        uint32_t lowerPriceRangeCollar() const { return readU32(data, 40); }
+        uint32_t upperPriceRangeCollar() const { return readU32(data, 44); }
+    };
+
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include "ItchParser.hpp"
+
+/*
+
+    MoldUDP64 packet ingest. A packet is a 20 byte header (10 byte session, 64-bit sequence number
+    of the first message, 16-bit message count) followed by message blocks framed exactly like the
+    flat ITCH files: a 2-byte big-endian length then the message.
+
+    Packets come from a pcap capture or a UDP socket and feed the same dispatch table as MmapReader,
+    so they publish into the same ring.
+
+*/
+
+namespace ITCH {
+
+    constexpr size_t   MOLD_SESSION_SIZE = 10;
+    constexpr size_t   MOLD_HEADER_SIZE = 20;
+    constexpr uint16_t MOLD_END_OF_SESSION = 0xFFFF;
+    constexpr size_t   MOLD_MAX_PAYLOAD = 1400;   // keeps packets under a 1500 byte MTU
+
+    struct MoldHeader {
+        char        session[MOLD_SESSION_SIZE];
+        uint64_t    sequence;   // sequence number of the first message block
+        uint16_t    count;      // message blocks in the packet, 0 = heartbeat, 0xFFFF = end of session
+    };
+
+    // Parse the packet header, false if the packet is too short
+    bool readMoldHeader(const char* data, size_t len, MoldHeader& header);
+
+    struct MoldSessionStats {
+        uint64_t packets = 0;
+        uint64_t messages = 0;
+        uint64_t heartbeats = 0;
+        uint64_t duplicates = 0;      // messages dropped because their sequence was already seen
+        uint64_t gaps = 0;            // packets that arrived ahead of the expected sequence
+        uint64_t missedMessages = 0;  // messages skipped over by those gaps
+        uint64_t malformed = 0;
+        bool     endOfSession = false;
+    };
+
+    // Tracks the sequence of one MoldUDP64 session and dispatches its messages in order
+    class MoldUdp64Session {
+    public:
+        // Reference mode is rejected, a packet buffer does not outlive the packet
+        explicit MoldUdp64Session(PublishMode mode = PublishMode::Decoded, const TypeMask& types = TypeMask::all());
+
+        // Returns false if the packet is malformed
+        bool onPacket(const char* data, size_t len);
+
+        // Dispatch count message blocks starting at blocks, the first one numbered firstSeq.
+        // Blocks below the expected sequence are dropped as duplicates, returns blocks consumed.
+        uint16_t deliver(const char* blocks, size_t len, uint64_t firstSeq, uint16_t count);
+
+        // Next sequence number expected, 0 until the first packet is seen (late join)
+        uint64_t expectedSequence() const { return nextSeq; }
+        void setExpectedSequence(uint64_t seq) { nextSeq = seq; }
+
+        std::string_view session() const { return {sessionName, MOLD_SESSION_SIZE}; }
+
+        // Snapshot of the counters, safe from any thread while the receive loop runs
+        MoldSessionStats stats() const;
+
+        // Messages dispatched so far, same as stats().messages without the other loads
+        uint64_t delivered() const { return counters.messages.load(std::memory_order_relaxed); }
+        bool endOfSession() const { return counters.endOfSession.load(std::memory_order_relaxed); }
+
+    private:
+        DispatchTable table;
+        char sessionName[MOLD_SESSION_SIZE] = {};
+        uint64_t nextSeq = 0;
+        // Only the receive thread writes these (load then store), stats() reads them from anywhere
+        struct Counters {
+            std::atomic<uint64_t> packets{0};
+            std::atomic<uint64_t> messages{0};
+            std::atomic<uint64_t> heartbeats{0};
+            std::atomic<uint64_t> duplicates{0};
+            std::atomic<uint64_t> gaps{0};
+            std::atomic<uint64_t> missedMessages{0};
+            std::atomic<uint64_t> malformed{0};
+            std::atomic<bool>     endOfSession{false};
+        };
+        Counters counters;
+    };
+
+    // Walks the UDP payloads of a classic pcap capture (Ethernet, VLAN, Linux SLL or raw IPv4)
+    class PcapReader {
+    public:
+        PcapReader() = delete;
+
+        // udpPort 0 accepts every UDP destination port
+        explicit PcapReader(const char* filename, uint16_t udpPort = 0);
+
+        PcapReader(const PcapReader& other) = delete;
+        PcapReader& operator=(const PcapReader& other) = delete;
+
+        ~PcapReader();
+
+        // Next matching UDP payload, false at the end of the capture
+        bool nextPayload(const char*& data, size_t& len);
+
+        // Feed every remaining payload to the session, returns the number of packets fed
+        uint64_t run(MoldUdp64Session& session);
+
+    private:
+        int fd;
+        char* start;
+        char* cursor;
+        char* end;
+        uint16_t port;
+        uint32_t linkType;
+        bool swapped;
+
+        uint32_t field32(const char* p) const;
+        bool udpPayload(const char* frame, size_t caplen, const char*& data, size_t& len) const;
+    };
+
+    // Receives MoldUDP64 datagrams on a local UDP socket, joining a multicast group if one is given
+    class UdpReader {
+    public:
+        UdpReader() = delete;
+
+        // port 0 binds an ephemeral port, see port()
+        explicit UdpReader(uint16_t port, const char* group = nullptr, const char* iface = "0.0.0.0");
+
+        UdpReader(const UdpReader& other) = delete;
+        UdpReader& operator=(const UdpReader& other) = delete;
+
+        ~UdpReader();
+
+        // Wait up to timeoutMs for one datagram, data stays valid until the next receive
+        bool receive(const char*& data, size_t& len, int timeoutMs);
+
+        // Wait up to timeoutMs for one datagram and feed it to the session, false on timeout
+        bool poll(MoldUdp64Session& session, int timeoutMs);
+
+        // Feed datagrams until running goes false or the session ends
+        void run(MoldUdp64Session& session, const std::atomic<bool>& running);
+
+        uint16_t port() const { return boundPort; }
+        int socketFd() const { return fd; }
+
+    private:
+        int fd;
+        uint16_t boundPort;
+        alignas(64) char buffer[65536];
+    };
+
+    // Packs ITCH messages into MoldUDP64 packets
+    class MoldPacketBuilder {
+    public:
+        explicit MoldPacketBuilder(std::string_view session);
+
+        // Start a new packet whose first message is numbered seq
+        void reset(uint64_t seq);
+
+        // Append one message, false if it does not fit in this packet
+        bool add(const char* msg, uint16_t len);
+
+        // Turn the current packet into a heartbeat (count 0) or end of session (count 0xFFFF)
+        void control(uint64_t seq, uint16_t count);
+
+        const char* data() const { return packet; }
+        size_t size() const { return length; }
+        uint16_t count() const { return messages; }
+        uint64_t nextSequence() const { return firstSeq + messages; }
+
+    private:
+        char packet[MOLD_HEADER_SIZE + MOLD_MAX_PAYLOAD];
+        size_t length;
+        uint16_t messages;
+        uint64_t firstSeq;
+
+        void writeHeader();
+    };
+
+    // Loopback stand-in for the exchange: replays an ITCH file as MoldUDP64 datagrams
+    class LoopbackSender {
+    public:
+        LoopbackSender() = delete;
+
+        explicit LoopbackSender(uint16_t port, const char* host = "127.0.0.1", std::string_view session = "EXCELSIOR0");
+
+        LoopbackSender(const LoopbackSender& other) = delete;
+        LoopbackSender& operator=(const LoopbackSender& other) = delete;
+
+        ~LoopbackSender();
+
+        // Send up to maxMessages from the file starting at sequence 1, returns messages sent.
+        // interPacketGap paces the sender so loopback socket buffers do not overflow, and
+        // dropEvery > 0 silently skips every dropEvery'th packet to simulate loss.
+        uint64_t sendFile(const char* itchFile, uint64_t maxMessages = UINT64_MAX,
+                          std::chrono::nanoseconds interPacketGap = std::chrono::nanoseconds(0),
+                          uint64_t dropEvery = 0);
+
+        void sendEndOfSession(uint64_t nextSeq);
+
+        void sendPacket(const char* data, size_t len);
+
+        // Same host only: hold each packet back while receiverFd's receive buffer is more than half
+        // full, so a receiver slower than the sender still gets every packet. -1 turns it off.
+        void throttle(int receiverFd) { throttleFd = receiverFd; }
+
+    private:
+        int fd;
+        int throttleFd = -1;
+        MoldPacketBuilder builder;
+    };
+
+    // Write an ITCH file as a pcap of MoldUDP64 over UDP/IPv4/Ethernet, returns messages written
+    uint64_t writeMoldPcap(const char* itchFile, const char* pcapFile, uint16_t port,
+                           uint64_t maxMessages = UINT64_MAX, std::string_view session = "EXCELSIOR0");
+
+}
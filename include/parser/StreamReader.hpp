@@ -0,0 +1,121 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ItchParser.hpp"
+
+/*
+
+    Parses gzip or zstd compressed ITCH files without inflating them to disk.
+
+    A dedicated thread decompresses into a small set of large reusable buffers while the parser
+    thread walks the previous one. Frames that straddle two buffers are stitched together in a
+    small carry buffer. Messages go through the same dispatch table as MmapReader.
+
+    zstd support needs the build flag EXCELSIOR_WITH_ZSTD (make ZSTD=1), plain and gzip input always work.
+
+*/
+
+namespace ITCH {
+
+    enum class Compression : uint8_t {
+        None,
+        Gzip,
+        Zstd
+    };
+
+    struct StreamStats {
+        uint64_t messages = 0;
+        uint64_t compressedBytes = 0;
+        uint64_t decompressedBytes = 0;
+        uint64_t buffersFilled = 0;
+        uint64_t parserStalls = 0;      // times the parser waited on the decompressor
+        uint64_t straddledFrames = 0;   // frames split across two buffers
+    };
+
+    class StreamReader {
+    public:
+        static constexpr size_t DEFAULT_BUFFER_SIZE = 64 << 20;
+        static constexpr size_t DEFAULT_BUFFER_COUNT = 3;
+
+        StreamReader() = delete;
+
+        // Compression is detected from the magic bytes. Reference mode is rejected, the
+        // buffers are reused as soon as they have been parsed.
+        explicit StreamReader(const char* filename,
+                              PublishMode mode = PublishMode::Decoded,
+                              const TypeMask& types = TypeMask::all(),
+                              size_t bufferSize = DEFAULT_BUFFER_SIZE,
+                              size_t bufferCount = DEFAULT_BUFFER_COUNT);
+
+        StreamReader(const StreamReader& other) = delete;
+        StreamReader& operator=(const StreamReader& other) = delete;
+
+        ~StreamReader();
+
+        // Decompress and dispatch the whole file, rethrows decompression errors and throws if the
+        // input is truncated mid frame
+        void parse();
+
+        Compression compression() const { return format; }
+        const StreamStats& stats() const { return counters; }
+
+    private:
+        struct Buffer {
+            std::unique_ptr<char[]> data;
+            size_t size = 0;
+        };
+
+        int fd;
+        Compression format;
+        DispatchTable table;
+        size_t bufferSize;
+        std::vector<Buffer> buffers;
+        StreamStats counters;
+
+        // Buffer handoff between the decompressor and the parser
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<size_t> freeBuffers;
+        std::deque<size_t> readyBuffers;
+        bool producerDone = false;
+        bool stopping = false;
+        std::exception_ptr producerError;
+        std::thread producer;
+
+        // Partial frame carried over from the previous buffer
+        std::vector<char> carry;
+
+        void decompressLoop();
+        size_t acquireFree();
+        void publishReady(size_t index);
+
+        // Fill one buffer from the source, returns bytes written, 0 at end of input
+        size_t fillPlain(char* dst, size_t capacity);
+        size_t fillGzip(char* dst, size_t capacity);
+        size_t fillZstd(char* dst, size_t capacity);
+
+        const char* consumeCarry(const char* p, const char* end);
+        const char* parseFrames(const char* p, const char* end);
+        void dispatch(const char* msg);
+
+        // Compressed input staging and codec state
+        std::unique_ptr<char[]> input;
+        size_t inputSize = 0;
+        size_t inputPos = 0;
+        bool inputEof = false;
+        void* codec = nullptr;
+        // Last ZSTD_decompressStream result, 0 only between complete frames
+        size_t zstdPending = 0;
+
+        bool refillInput();
+    };
+
+}
@@ -1,50 +1,41 @@
-#include <thread>
-#include <atomic>
-#include <iostream>
-#include "../utils/SpmcRingBuffer.cpp"
+#include <array>
+#include <stdexcept>
+#include "../../include/orderbook/BookBuilder.hpp"
 #include "../../include/parser/ItchParser.hpp"
 
-class Orderbook;
-
-class BookBuilder {
-public:
-    BookBuilder(SPMC_RingBuffer<ITCH::MsgEnvelope>& ring, uint16_t securityNameIdx, Orderbook& book)
-        : ringBuffer_(ring), securityId_(securityNameIdx), running_(true), book_(book) {
-        worker_ = std::thread(&BookBuilder::pollLoop, this);
-    }
-
-    ~BookBuilder() {
-        running_ = false;
-        if (worker_.joinable())
-            worker_.join();
+BookBuilder::BookBuilder(SPMC_Queue& queue, Orderbook& book, WaitStrategy strategy, BookPublisher* publisher)
+    : queue_(queue), book_(book), strategy_(strategy), publisher_(publisher), running_(true), ready_(false), processed_(0) {
+    if (queue.mode() != QueueMode::Lossless) {
+        throw std::invalid_argument("BookBuilder needs a Lossless queue");
     }
-
-private:
-    void pollLoop() {
-        ConsumerState state; // owns read index
-        while (running_) {
-            auto maybe = ringBuffer_.tryRead(state.readIdx);
-            if (!maybe.has_value()) continue;
-
-            const ITCH::MsgEnvelope& msg = *maybe;
-
-            // Check type and filter by security ID
-            if (msg.type == ITCH::AddOrderMsgType) {
-                const ITCH::AddOrderMsg& order = msg.as<ITCH::AddOrderMsg>();
-                if (order.securityNameIdx == securityId_) {
-                    std::cout << "AddOrder for " << securityId_
-                              << " at price " << order.price
-                              << " qty " << order.quantity << '\n';
-                }
-            }
-
-            ++state.readIdx;
+    worker_ = std::thread(&BookBuilder::pollLoop, this);
+    while (!ready_.load()) std::this_thread::yield();
+}
+
+BookBuilder::~BookBuilder() {
+    running_ = false;
+    queue_.wakeSleepers();
+    if (worker_.joinable())
+        worker_.join();
+}
+
+void BookBuilder::pollLoop() {
+    SPMC_Reader reader(queue_, false, strategy_); // owns read sequence
+    ready_.store(true);
+    std::array<uint8_t, 64> scratch;
+    PayloadSize size;
+    LATENCY_PROBE(ConsumerLatency& latency = LatencyStats::consumer("BookBuilder"));
+    while (running_) {
+        ReadStatus status = reader.Read(scratch.data(), size);
+        if (status == ReadStatus::NotReady) {
+            reader.Wait();
+            continue;
         }
-    }
+        if (status != ReadStatus::Ok) continue;
+        LATENCY_PROBE(latency.received(reader.position() - 1, scratch[0]));
 
-    SPMC_RingBuffer<ITCH::MsgEnvelope>& ringBuffer_;
-    uint16_t securityId_;
-    std::atomic<bool> running_;
-    std::thread worker_;
-    Orderbook& book_;
-};
+        if (book_.apply(scratch.data()) && publisher_) publisher_->publish(scratch.data());
+        processed_.store(processed_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        LATENCY_PROBE(latency.handled());
+    }
+}
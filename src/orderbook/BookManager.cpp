@@ -0,0 +1,283 @@
+#include "../../include/orderbook/BookManager.hpp"
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+BookManager::BookManager(SPMC_Queue& queue, const BookManagerConfig& config)
+    : queue(queue), config(config), owner(std::make_unique<std::atomic<uint16_t>[]>(LOCATES)), lastCounts(LOCATES) {
+
+    if (config.workers == 0 || config.workers > UINT16_MAX) {
+        throw std::invalid_argument("Worker count must be in [1, 65535]");
+    }
+    // An overwritten handover range would lose messages for the symbol being moved
+    if (queue.mode() != QueueMode::Lossless) {
+        throw std::invalid_argument("BookManager needs a Lossless queue");
+    }
+
+    for (size_t locate = 1; locate < LOCATES; ++locate) {
+        owner[locate].store(static_cast<uint16_t>(config.partition(static_cast<uint16_t>(locate), config.workers) % config.workers),
+                            std::memory_order_relaxed);
+    }
+
+    for (size_t i = 0; i < config.workers; ++i) {
+        auto worker = std::make_unique<Worker>();
+        worker->id = i;
+        worker->book = std::make_unique<Orderbook>(config.book);
+        worker->owned.assign(LOCATES, 0);
+        worker->counts = std::make_unique<std::atomic<uint32_t>[]>(LOCATES);
+        for (size_t locate = 1; locate < LOCATES; ++locate) {
+            worker->owned[locate] = owner[locate].load(std::memory_order_relaxed) == i;
+        }
+        workers.push_back(std::move(worker));
+    }
+
+    for (auto& worker : workers) {
+        worker->thread = std::thread(&BookManager::run, this, std::ref(*worker));
+        if (config.cores.empty()) continue;
+
+        const int core = config.cores[worker->id % config.cores.size()];
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        if (pthread_setaffinity_np(worker->thread.native_handle(), sizeof(set), &set) != 0) {
+            stop();
+            throw std::runtime_error("Failed to pin book worker to core " + std::to_string(core));
+        }
+    }
+
+    // Every reader is registered before the producer can run past them
+    while (ready.load() < workers.size()) std::this_thread::yield();
+
+    if (config.rebalanceIntervalMs) rebalancer = std::thread(&BookManager::rebalanceLoop, this);
+}
+
+BookManager::~BookManager() {
+    stop();
+}
+
+void BookManager::stop() {
+    {
+        std::lock_guard<std::mutex> lock(stopMutex);
+        running = false;
+    }
+    stopSignal.notify_all();
+    if (rebalancer.joinable()) rebalancer.join();
+
+    queue.wakeSleepers();
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+
+    // A move cut short between extract and adopt still has the symbol's orders in hand: finish
+    // it on the taker's book so every symbol is on exactly one book and owner says which
+    std::lock_guard<std::mutex> lock(controlMutex);
+    Move* move = pending.exchange(nullptr);
+    if (!move) return;
+    if (move->packed.load() && !move->done.load()) {
+        Worker& taker = *workers[move->to];
+        taker.book->adopt(move->locate, move->orders);
+        taker.owned[move->locate] = 1;
+        move->done.store(true);
+    }
+    // Also covers a taker that finished after execute() had given up on the move
+    if (move->done.load() && owner[move->locate].load(std::memory_order_relaxed) != move->to) {
+        owner[move->locate].store(static_cast<uint16_t>(move->to), std::memory_order_relaxed);
+        ++completedMoves;
+    }
+    move->orders.clear();
+    move->orders.shrink_to_fit();
+}
+
+uint64_t BookManager::position() const {
+    uint64_t lowest = UINT64_MAX;
+    for (const auto& worker : workers) lowest = std::min(lowest, worker->position.load(std::memory_order_acquire));
+    return lowest;
+}
+
+void BookManager::run(Worker& worker) {
+    SPMC_Reader reader(queue, false, config.strategy);
+    std::vector<QueueMessage> batch(READ_BATCH);
+    ready.fetch_add(1);
+
+    while (running.load(std::memory_order_relaxed)) {
+        const uint64_t position = reader.position();
+        serviceMove(worker, position);
+
+        // Never read past an acknowledged handover, it has to land on a batch boundary
+        size_t limit = READ_BATCH;
+        if (position < worker.handoverAt) limit = std::min<uint64_t>(limit, worker.handoverAt - position);
+
+        auto got = reader.ReadBatch(std::span<QueueMessage>(batch.data(), limit));
+        if (got.empty()) {
+            reader.Wait();
+            continue;
+        }
+        for (const QueueMessage& m : got) apply(worker, m.payload);
+        worker.position.store(reader.position(), std::memory_order_release);
+    }
+}
+
+void BookManager::apply(Worker& worker, const uint8_t* payload) {
+    // Every decoded message has the locate at the same offset
+    uint16_t locate;
+    std::memcpy(&locate, payload + offsetof(ITCH::AddOrderMsg, securityNameIdx), sizeof(locate));
+    if (!worker.owned[locate]) return;
+
+    worker.book->apply(payload);
+    std::atomic<uint32_t>& count = worker.counts[locate];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void BookManager::serviceMove(Worker& worker, uint64_t position) {
+    Move* move = pending.load(std::memory_order_acquire);
+    if (!move) return;
+
+    handover(worker, move, position);
+    // Done with it. pending only moves forward, so once every worker has seen a later move this one can go
+    worker.seenMove.store(move->id, std::memory_order_release);
+}
+
+void BookManager::handover(Worker& worker, Move* move, uint64_t position) {
+    if (move->id == worker.lastMove) return;
+
+    const bool giving = move->from == worker.id;
+    if (!giving && move->to != worker.id) return;
+
+    if (worker.handoverAt == NO_SEQ) {
+        // Hold here until the other side has acknowledged too, so neither passes the handover under the old owner
+        (giving ? move->fromAt : move->toAt).store(position, std::memory_order_release);
+        const std::atomic<uint64_t>& other = giving ? move->toAt : move->fromAt;
+        uint64_t theirs;
+        while ((theirs = other.load(std::memory_order_acquire)) == NO_SEQ) {
+            if (!running.load(std::memory_order_relaxed)) return;
+            queue.wakeSleepers();
+            std::this_thread::yield();
+        }
+        worker.handoverAt = std::max(position, theirs);
+    }
+    if (position < worker.handoverAt) return;
+
+    if (giving) {
+        worker.book->extract(move->locate, move->orders);
+        worker.owned[move->locate] = 0;
+        move->packed.store(true, std::memory_order_release);
+    } else {
+        // The giving side is behind at most by the distance between the two readers
+        while (!move->packed.load(std::memory_order_acquire)) {
+            if (!running.load(std::memory_order_relaxed)) return;
+            std::this_thread::yield();
+        }
+        worker.book->adopt(move->locate, move->orders);
+        worker.owned[move->locate] = 1;
+        move->done.store(true, std::memory_order_release);
+    }
+    worker.handoverAt = NO_SEQ;
+    worker.lastMove = move->id;
+}
+
+bool BookManager::move(uint16_t locate, size_t worker) {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    if (locate == MARKET_WIDE_LOCATE || worker >= workers.size()) {
+        throw std::invalid_argument("No such locate or worker");
+    }
+    const size_t from = owner[locate].load(std::memory_order_relaxed);
+    if (from == worker) return false;
+    return execute(locate, from, worker);
+}
+
+bool BookManager::execute(uint16_t locate, size_t from, size_t to) {
+    // Once stopping, the move stop() has to settle stays the pending one
+    if (!running.load()) return false;
+
+    auto move = std::make_unique<Move>();
+    move->id = ++movesStarted;
+    move->locate = locate;
+    move->from = from;
+    move->to = to;
+    Move* current = move.get();
+    moveLog.push_back(std::move(move));
+
+    pending.store(current, std::memory_order_release);
+    queue.wakeSleepers();
+    while (!current->done.load(std::memory_order_acquire)) {
+        if (!running.load()) return false;
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+    current->orders.clear();
+    current->orders.shrink_to_fit();
+    owner[locate].store(static_cast<uint16_t>(to), std::memory_order_relaxed);
+    ++completedMoves;
+    trimMoveLog();
+    return true;
+}
+
+void BookManager::trimMoveLog() {
+    // A worker may still be reading any move at or after the oldest one it has seen, including ones it
+    // is not part of, the pending move is always among them
+    uint64_t oldest = UINT64_MAX;
+    for (const auto& worker : workers) oldest = std::min(oldest, worker->seenMove.load(std::memory_order_acquire));
+
+    auto keep = std::find_if(moveLog.begin(), moveLog.end(), [&](const auto& move) { return move->id >= oldest; });
+    moveLog.erase(moveLog.begin(), keep);
+}
+
+bool BookManager::rebalance() {
+    std::lock_guard<std::mutex> lock(controlMutex);
+    if (!running.load()) return false;
+
+    // Messages per locate since the last call, and what that makes each worker's load
+    std::vector<uint32_t> rates(LOCATES);
+    std::vector<uint64_t> load(workers.size());
+    uint64_t total = 0;
+    for (size_t locate = 1; locate < LOCATES; ++locate) {
+        uint32_t sum = 0;
+        for (const auto& worker : workers) sum += worker->counts[locate].load(std::memory_order_relaxed);
+        rates[locate] = sum - lastCounts[locate];
+        lastCounts[locate] = sum;
+        load[owner[locate].load(std::memory_order_relaxed)] += rates[locate];
+        total += rates[locate];
+    }
+
+    const size_t busiest = std::max_element(load.begin(), load.end()) - load.begin();
+    const size_t idlest = std::min_element(load.begin(), load.end()) - load.begin();
+    const uint64_t gap = load[busiest] - load[idlest];
+    const double mean = static_cast<double>(total) / workers.size();
+    if (total == 0 || gap <= config.imbalance * mean) return false;
+
+    // Only at a quiet point: neither side may be working through a backlog
+    const uint64_t head = queue.head();
+    if (head - workers[busiest]->position.load() > config.quietBacklog ||
+        head - workers[idlest]->position.load() > config.quietBacklog) return false;
+
+    // The symbol whose rate is closest to half the gap evens the pair out best, anything under the gap helps
+    size_t best = 0;
+    double bestDistance = static_cast<double>(gap);
+    for (size_t locate = 1; locate < LOCATES; ++locate) {
+        if (owner[locate].load(std::memory_order_relaxed) != busiest || rates[locate] == 0 || rates[locate] >= gap) continue;
+        const double distance = std::abs(static_cast<double>(rates[locate]) - gap / 2.0);
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            best = locate;
+        }
+    }
+    if (!best) return false;
+    return execute(static_cast<uint16_t>(best), busiest, idlest);
+}
+
+void BookManager::rebalanceLoop() {
+    std::unique_lock<std::mutex> lock(stopMutex);
+    while (running) {
+        stopSignal.wait_for(lock, std::chrono::milliseconds(config.rebalanceIntervalMs), [&] { return !running; });
+        if (!running) break;
+        lock.unlock();
+        rebalance();
+        lock.lock();
+    }
+}
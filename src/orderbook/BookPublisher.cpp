@@ -0,0 +1,175 @@
+#include "../../include/orderbook/BookPublisher.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+BookSubscriber::BookSubscriber(const BookPublisher& publisher)
+    : publisher(publisher),
+      dirty(std::make_unique<std::atomic<uint8_t>[]>(LOCATES)),
+      queue(std::make_unique_for_overwrite<uint16_t[]>(LOCATES)) {
+}
+
+void BookSubscriber::markDirty(uint16_t locate) {
+    // Pairs with the exchange in next(): whoever clears the flag sees the slot as it was when it was set
+    if (dirty[locate].exchange(1, std::memory_order_acq_rel)) return;
+    const uint64_t t = tail.load(std::memory_order_relaxed);
+    queue[t & (LOCATES - 1)] = locate;
+    tail.store(t + 1, std::memory_order_release);
+}
+
+bool BookSubscriber::next(uint16_t& locate, BookSnapshot& snapshot) {
+    const uint64_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) return false;
+    locate = queue[h & (LOCATES - 1)];
+    head.store(h + 1, std::memory_order_release);
+
+    // Clear before reading, so a change that lands after the read queues the symbol again
+    dirty[locate].exchange(0, std::memory_order_acq_rel);
+    publisher.read(locate, snapshot);
+    return true;
+}
+
+size_t BookSubscriber::pending() const {
+    return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+}
+
+BookPublisher::BookPublisher(const Orderbook& book, SPMC_Queue& ring, const PublisherConfig& config)
+    : book(book), ring(ring), config(config),
+      slots(std::make_unique<std::atomic<Slot*>[]>(LOCATES)),
+      modes(std::make_unique<std::atomic<Conflation>[]>(LOCATES)),
+      subscribers(config.maxSubscribers) {
+
+    if (config.depth == 0 || config.depth > BookSnapshot::MAX_DEPTH) {
+        throw std::invalid_argument("Published depth must be in [1, " + std::to_string(BookSnapshot::MAX_DEPTH) + "]");
+    }
+    for (size_t locate = 0; locate < LOCATES; ++locate) {
+        modes[locate].store(config.conflation, std::memory_order_relaxed);
+    }
+}
+
+void BookPublisher::setConflation(uint16_t locate, Conflation mode) {
+    modes[locate].store(mode, std::memory_order_relaxed);
+}
+
+Conflation BookPublisher::conflation(uint16_t locate) const {
+    return modes[locate].load(std::memory_order_relaxed);
+}
+
+BookSubscriber& BookPublisher::subscribe() {
+    std::lock_guard<std::mutex> lock(subscribeMutex);
+    const size_t index = subscriberCount.load(std::memory_order_relaxed);
+    if (index == subscribers.size()) {
+        throw std::runtime_error("Book publisher has no room for another subscriber");
+    }
+    subscribers[index].reset(new BookSubscriber(*this));
+    subscriberCount.store(index + 1, std::memory_order_release);
+    return *subscribers[index];
+}
+
+void BookPublisher::publish(const uint8_t* payload) {
+    // Every decoded message has the locate at the same offset
+    uint16_t locate;
+    std::memcpy(&locate, payload + offsetof(ITCH::AddOrderMsg, securityNameIdx), sizeof(locate));
+    update(locate);
+}
+
+void BookPublisher::update(uint16_t locate) {
+    current.bidLevels = static_cast<uint8_t>(book.depth(locate, ITCH::Side::BUY, std::span(current.bids.data(), config.depth)));
+    current.askLevels = static_cast<uint8_t>(book.depth(locate, ITCH::Side::SELL, std::span(current.asks.data(), config.depth)));
+
+    // Only this thread writes the slot, so it can read it without the seqlock. A symbol without
+    // one has never been published and compares against an empty book.
+    static const BookSnapshot empty{};
+    const Slot* existing = slots[locate].load(std::memory_order_relaxed);
+    const BookSnapshot& before = existing ? existing->snapshot : empty;
+    const std::span<const BookLevel> bids(current.bids.data(), current.bidLevels);
+    const std::span<const BookLevel> asks(current.asks.data(), current.askLevels);
+    const std::span<const BookLevel> oldBids(before.bids.data(), before.bidLevels);
+    const std::span<const BookLevel> oldAsks(before.asks.data(), before.askLevels);
+    if (std::ranges::equal(bids, oldBids) && std::ranges::equal(asks, oldAsks)) return;
+
+    Slot& slot = slotFor(locate);
+    current.update = before.update + 1;
+    if (modes[locate].load(std::memory_order_relaxed) == Conflation::None) {
+        publishTop(locate, before, current);
+        publishSide(locate, ITCH::Side::BUY, current.update, oldBids, bids);
+        publishSide(locate, ITCH::Side::SELL, current.update, oldAsks, asks);
+        ring.Publish();
+        write(slot, current);
+        return;
+    }
+
+    write(slot, current);
+    const size_t count = subscriberCount.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) subscribers[i]->markDirty(locate);
+    conflatedCount.store(conflatedCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+bool BookPublisher::read(uint16_t locate, BookSnapshot& snapshot) const {
+    const Slot* slot = slots[locate].load(std::memory_order_acquire);
+    if (!slot) return false;
+
+    // Same odd/even versioning as the queue blocks, retry while the publisher is mid write
+    for (;;) {
+        const uint64_t version = slot->version.load(std::memory_order_acquire);
+        if (version & 1) continue;
+        std::memcpy(&snapshot, &slot->snapshot, sizeof(snapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->version.load(std::memory_order_relaxed) == version) return true;
+    }
+}
+
+BookPublisher::Slot& BookPublisher::slotFor(uint16_t locate) {
+    Slot* slot = slots[locate].load(std::memory_order_relaxed);
+    if (slot) return *slot;
+
+    slotStorage.push_back(std::make_unique<Slot>());
+    slot = slotStorage.back().get();
+    slots[locate].store(slot, std::memory_order_release);
+    return *slot;
+}
+
+void BookPublisher::write(Slot& slot, const BookSnapshot& snapshot) {
+    const uint64_t version = slot.version.load(std::memory_order_relaxed);
+    slot.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&slot.snapshot, &snapshot, sizeof(snapshot));
+    slot.version.store(version + 2, std::memory_order_release);
+}
+
+void BookPublisher::publishTop(uint16_t locate, const BookSnapshot& before, const BookSnapshot& after) {
+    auto best = [](const auto& levels, uint8_t count) { return count ? levels[0] : BookLevel{}; };
+    const BookLevel bid = best(after.bids, after.bidLevels);
+    const BookLevel ask = best(after.asks, after.askLevels);
+    if (bid == best(before.bids, before.bidLevels) && ask == best(before.asks, before.askLevels)) return;
+
+    const BookFeed::TopOfBookMsg msg{BookFeed::TopOfBookMsgType, locate, after.update, bid, ask};
+    ring.Stage(sizeof(msg), [&](uint8_t* payload) { std::memcpy(payload, &msg, sizeof(msg)); });
+    ringCount.store(ringCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void BookPublisher::publishSide(uint16_t locate, char side, uint64_t update,
+                                std::span<const BookLevel> before, std::span<const BookLevel> after) {
+    auto emit = [&](const BookLevel& level) {
+        const BookFeed::DepthMsg msg{BookFeed::DepthMsgType, side, locate, update, level};
+        ring.Stage(sizeof(msg), [&](uint8_t* payload) { std::memcpy(payload, &msg, sizeof(msg)); });
+        ringCount.store(ringCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    };
+    auto ahead = [&](uint32_t a, uint32_t b) { return side == ITCH::Side::BUY ? a > b : a < b; };
+
+    // Both lists are best first, merge them by price
+    size_t i = 0, j = 0;
+    while (i < before.size() || j < after.size()) {
+        if (j == after.size() || (i < before.size() && ahead(before[i].price, after[j].price))) {
+            emit({before[i++].price, 0, 0});
+        } else if (i == before.size() || ahead(after[j].price, before[i].price)) {
+            emit(after[j++]);
+        } else {
+            if (!(before[i] == after[j])) emit(after[j]);
+            ++i;
+            ++j;
+        }
+    }
+}
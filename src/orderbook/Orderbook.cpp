@@ -0,0 +1,221 @@
+#include "../../include/orderbook/Orderbook.hpp"
+#include <algorithm>
+
+Orderbook::Orderbook(const BookConfig& config)
+    : config(config), orders(config.expectedOrders),
+      books(UINT16_MAX + 1, SymbolBook{Bids(config.ladderSlots, config.maxLadderSlots),
+                                       Asks(config.ladderSlots, config.maxLadderSlots)}) {
+}
+
+bool Orderbook::apply(const uint8_t* payload) {
+    switch (static_cast<char>(payload[0])) {
+        case ITCH::AddOrderMsgType:
+        case ITCH::AddOrderMPIDAttributionMsgType: {
+            // F only appends the attribution, the common prefix is an AddOrderMsg
+            const auto& m = *reinterpret_cast<const ITCH::AddOrderMsg*>(payload);
+            return add(m.securityNameIdx, m.orderId, m.side, m.quantity, m.price);
+        }
+        case ITCH::OrderExecutedMsgType: {
+            const auto& m = *reinterpret_cast<const ITCH::OrderExecutedMsg*>(payload);
+            return execute(m.orderId, m.executedQuantity);
+        }
+        case ITCH::OrderExecutedWithPriceMsgType: {
+            // Prints at executedPrice but the resting order keeps its own price
+            const auto& m = *reinterpret_cast<const ITCH::OrderExecutedWithPriceMsg*>(payload);
+            return execute(m.orderId, m.executedQuantity);
+        }
+        case ITCH::OrderCancelMsgType: {
+            const auto& m = *reinterpret_cast<const ITCH::OrderCancelMsg*>(payload);
+            return cancel(m.orderId, m.cancelledQuantity);
+        }
+        case ITCH::OrderDeleteMsgType: {
+            const auto& m = *reinterpret_cast<const ITCH::OrderDeleteMsg*>(payload);
+            return remove(m.orderId);
+        }
+        case ITCH::OrderReplaceMsgType: {
+            const auto& m = *reinterpret_cast<const ITCH::OrderReplaceMsg*>(payload);
+            return replace(m.ogOrderId, m.newOrderId, m.quantity, m.price);
+        }
+        default:
+            return false;
+    }
+}
+
+bool Orderbook::add(uint16_t locate, uint64_t ref, char side, uint32_t shares, uint32_t price) {
+    ++counters.adds;
+    return insert(locate, ref, side, shares, price);
+}
+
+bool Orderbook::execute(uint64_t ref, uint32_t shares) {
+    ++counters.executions;
+    return reduce(ref, shares);
+}
+
+bool Orderbook::cancel(uint64_t ref, uint32_t shares) {
+    ++counters.cancels;
+    return reduce(ref, shares);
+}
+
+bool Orderbook::remove(uint64_t ref) {
+    ++counters.deletes;
+    return reduce(ref, UINT32_MAX);
+}
+
+bool Orderbook::replace(uint64_t ref, uint64_t newRef, uint32_t shares, uint32_t price) {
+    ++counters.replaces;
+    const OrderHandle handle = orders.find(ref);
+    if (handle == NO_ORDER) {
+        ++counters.unknownOrders;
+        return false;
+    }
+
+    // The replacement keeps symbol and side but goes to the back of its new level
+    const uint16_t locate = orders[handle].locate;
+    const char side = orders[handle].side;
+    erase(ref, handle);
+    return insert(locate, newRef, side, shares, price);
+}
+
+BookLevel Orderbook::bestBid(uint16_t locate) const {
+    const Bids& bids = books[locate].bids;
+    if (bids.empty()) return {};
+    const uint32_t price = bids.bestPrice();
+    const Level& level = *bids.find(price);
+    return {price, level.orders, level.shares};
+}
+
+BookLevel Orderbook::bestAsk(uint16_t locate) const {
+    const Asks& asks = books[locate].asks;
+    if (asks.empty()) return {};
+    const uint32_t price = asks.bestPrice();
+    const Level& level = *asks.find(price);
+    return {price, level.orders, level.shares};
+}
+
+size_t Orderbook::depth(uint16_t locate, char side, std::span<BookLevel> out) const {
+    auto fill = [&](const auto& levels) {
+        size_t n = 0;
+        if (out.empty()) return n;
+        levels.forEach([&](uint32_t price, const Level& level) {
+            out[n++] = {price, level.orders, level.shares};
+            return n < out.size();
+        });
+        return n;
+    };
+    const SymbolBook& book = books[locate];
+    return side == ITCH::Side::BUY ? fill(book.bids) : fill(book.asks);
+}
+
+size_t Orderbook::levels(uint16_t locate, char side) const {
+    const SymbolBook& book = books[locate];
+    return side == ITCH::Side::BUY ? book.bids.size() : book.asks.size();
+}
+
+std::optional<QueuePosition> Orderbook::queuePosition(uint64_t ref) const {
+    const OrderHandle handle = orders.find(ref);
+    if (handle == NO_ORDER) return std::nullopt;
+
+    const RestingOrder& order = orders[handle];
+    QueuePosition position{order.locate, order.side, order.price, order.shares, 0, 0};
+    for (OrderHandle h = order.prev; h != NO_ORDER; h = orders[h].prev) {
+        ++position.ordersAhead;
+        position.sharesAhead += orders[h].shares;
+    }
+    return position;
+}
+
+void Orderbook::extract(uint16_t locate, std::vector<ExportedOrder>& out) {
+    const size_t first = out.size();
+    auto collect = [&](const auto& levels) {
+        levels.forEach([&](uint32_t, const Level& level) {
+            for (OrderHandle h = level.head; h != NO_ORDER; h = orders[h].next) {
+                const RestingOrder& order = orders[h];
+                out.push_back({order.ref, order.price, order.shares, order.side});
+            }
+            return true;
+        });
+    };
+    SymbolBook& book = books[locate];
+    collect(book.bids);
+    collect(book.asks);
+
+    for (size_t i = first; i < out.size(); ++i) erase(out[i].ref, orders.find(out[i].ref));
+}
+
+void Orderbook::adopt(uint16_t locate, std::span<const ExportedOrder> incoming) {
+    for (const ExportedOrder& order : incoming) {
+        insert(locate, order.ref, order.side, order.shares, order.price);
+    }
+}
+
+template <typename Fn>
+decltype(auto) Orderbook::onSide(SymbolBook& book, char side, Fn&& fn) {
+    return side == ITCH::Side::BUY ? fn(book.bids) : fn(book.asks);
+}
+
+template <typename Levels>
+void Orderbook::link(Levels& levels, OrderHandle handle) {
+    RestingOrder& order = orders[handle];
+    Level& level = levels.level(order.price);
+
+    order.prev = level.tail;
+    order.next = NO_ORDER;
+    if (level.tail != NO_ORDER) orders[level.tail].next = handle;
+    else level.head = handle;
+    level.tail = handle;
+
+    level.shares += order.shares;
+    ++level.orders;
+}
+
+template <typename Levels>
+void Orderbook::unlink(Levels& levels, OrderHandle handle) {
+    const RestingOrder& order = orders[handle];
+    Level& level = *levels.find(order.price);
+
+    if (order.prev != NO_ORDER) orders[order.prev].next = order.next;
+    else level.head = order.next;
+    if (order.next != NO_ORDER) orders[order.next].prev = order.prev;
+    else level.tail = order.prev;
+
+    level.shares -= order.shares;
+    if (--level.orders == 0) levels.erase(order.price);
+}
+
+bool Orderbook::insert(uint16_t locate, uint64_t ref, char side, uint32_t shares, uint32_t price) {
+    const OrderHandle handle = orders.insert(ref);
+    if (handle == NO_ORDER) {
+        ++counters.duplicateOrders;
+        return false;
+    }
+
+    orders[handle] = {ref, price, shares, NO_ORDER, NO_ORDER, locate, side};
+    onSide(books[locate], side, [&](auto& levels) { link(levels, handle); });
+    return true;
+}
+
+bool Orderbook::reduce(uint64_t ref, uint32_t shares) {
+    const OrderHandle handle = orders.find(ref);
+    if (handle == NO_ORDER) {
+        ++counters.unknownOrders;
+        return false;
+    }
+
+    RestingOrder& order = orders[handle];
+    if (shares >= order.shares) {
+        erase(ref, handle);
+        return true;
+    }
+
+    order.shares -= shares;
+    onSide(books[order.locate], order.side, [&](auto& levels) {
+        levels.find(order.price)->shares -= shares;
+    });
+    return true;
+}
+
+void Orderbook::erase(uint64_t ref, OrderHandle handle) {
+    const RestingOrder& order = orders[handle];
+    onSide(books[order.locate], order.side, [&](auto& levels) { unlink(levels, handle); });
+    orders.erase(ref);
+}
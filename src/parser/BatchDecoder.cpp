@@ -0,0 +1,236 @@
+#include "../../include/parser/BatchDecoder.hpp"
+#include <arpa/inet.h>
+#include <immintrin.h>
+#include <cstring>
+
+namespace ITCH {
+
+    namespace {
+
+        struct SwapKernels {
+            void (*swap16)(uint16_t*, size_t);
+            void (*swap32)(uint32_t*, size_t);
+            void (*swap64)(uint64_t*, size_t);
+            const char* name;
+        };
+
+        // Scalar fallback, also used for the tails of the vector kernels
+
+        void swap16Scalar(uint16_t* p, size_t n) {
+            for (size_t i = 0; i < n; ++i) p[i] = __builtin_bswap16(p[i]);
+        }
+
+        void swap32Scalar(uint32_t* p, size_t n) {
+            for (size_t i = 0; i < n; ++i) p[i] = __builtin_bswap32(p[i]);
+        }
+
+        void swap64Scalar(uint64_t* p, size_t n) {
+            for (size_t i = 0; i < n; ++i) p[i] = __builtin_bswap64(p[i]);
+        }
+
+        // SSSE3, one pshufb per 16 bytes
+
+        __attribute__((target("ssse3")))
+        void swap16Ssse3(uint16_t* p, size_t n) {
+            const __m128i mask = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), _mm_shuffle_epi8(v, mask));
+            }
+            swap16Scalar(p + i, n - i);
+        }
+
+        __attribute__((target("ssse3")))
+        void swap32Ssse3(uint32_t* p, size_t n) {
+            const __m128i mask = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), _mm_shuffle_epi8(v, mask));
+            }
+            swap32Scalar(p + i, n - i);
+        }
+
+        __attribute__((target("ssse3")))
+        void swap64Ssse3(uint64_t* p, size_t n) {
+            const __m128i mask = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+            size_t i = 0;
+            for (; i + 2 <= n; i += 2) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), _mm_shuffle_epi8(v, mask));
+            }
+            swap64Scalar(p + i, n - i);
+        }
+
+        // AVX2, vpshufb shuffles within each 128-bit lane so the lane mask is repeated
+
+        __attribute__((target("avx2")))
+        void swap16Avx2(uint16_t* p, size_t n) {
+            const __m256i mask = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                                  1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + i), _mm256_shuffle_epi8(v, mask));
+            }
+            swap16Scalar(p + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        void swap32Avx2(uint32_t* p, size_t n) {
+            const __m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                                  3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + i), _mm256_shuffle_epi8(v, mask));
+            }
+            swap32Scalar(p + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        void swap64Avx2(uint64_t* p, size_t n) {
+            const __m256i mask = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                                  7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + i), _mm256_shuffle_epi8(v, mask));
+            }
+            swap64Scalar(p + i, n - i);
+        }
+
+        SwapKernels selectKernels() {
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                return {swap16Avx2, swap32Avx2, swap64Avx2, "avx2"};
+            }
+            if (__builtin_cpu_supports("ssse3")) {
+                return {swap16Ssse3, swap32Ssse3, swap64Ssse3, "ssse3"};
+            }
+            return {swap16Scalar, swap32Scalar, swap64Scalar, "scalar"};
+        }
+
+        const SwapKernels& kernels() {
+            static const SwapKernels k = selectKernels();
+            return k;
+        }
+
+        template <typename T>
+        inline void loadRaw(T& dst, const char* data, size_t offset) {
+            std::memcpy(&dst, data + offset, sizeof(T));
+        }
+
+        constexpr uint64_t TIMESTAMP_MASK = (uint64_t(1) << 48) - 1;
+    }
+
+    BatchDecoder::BatchDecoder(BatchSink onBatch, OtherSink onOther)
+        : onBatch(std::move(onBatch)), onOther(std::move(onOther)) {
+        slotOf.fill(-1);
+        for (size_t i = 0; i < BATCHED_TYPES.size(); ++i) {
+            slotOf[static_cast<uint8_t>(BATCHED_TYPES[i])] = static_cast<int8_t>(i);
+            batches[i].type = BATCHED_TYPES[i];
+            batches[i].count = 0;
+        }
+    }
+
+    const char* BatchDecoder::kernelName() {
+        return kernels().name;
+    }
+
+    BatchDecodeResult BatchDecoder::decode(const char* begin, const char* end, uint64_t firstSeq) {
+        const char* p = begin;
+        uint64_t seq = firstSeq;
+
+        while (p + 2 <= end) {
+            uint16_t msgLength = ntohs(*reinterpret_cast<const uint16_t*>(p));
+            if (p + 2 + msgLength > end) break;
+
+            const char* data = p + 2;
+            p += 2 + msgLength;
+
+            int8_t slot = slotOf[static_cast<uint8_t>(data[0])];
+
+            [[likely]] if (slot >= 0) {
+                OrderColumns& batch = batches[slot];
+                gather(batch, data, seq);
+                if (batch.count == OrderColumns::CAPACITY) flush(batch);
+            }
+
+            else {
+                onOther(seq, data);
+            }
+
+            ++seq;
+        }
+
+        for (OrderColumns& batch : batches) {
+            if (batch.count) flush(batch);
+        }
+
+        return {p, seq - firstSeq};
+    }
+
+    void BatchDecoder::gather(OrderColumns& b, const char* d, uint64_t seq) {
+        const size_t i = b.count++;
+        b.seq[i] = seq;
+        loadRaw(b.locates[i], d, 1);
+        // 8 bytes starting at the tracking number put the 48-bit timestamp in the low bytes once swapped
+        loadRaw(b.timestamps[i], d, 3);
+        loadRaw(b.orderIds[i], d, 11);
+
+        switch (b.type) {
+            case AddOrderMsgType:
+            case TradeMsgType:
+                b.sides[i] = d[19];
+                loadRaw(b.quantities[i], d, 20);
+                loadRaw(b.prices[i], d, 32);
+                break;
+            case OrderExecutedMsgType:
+            case OrderCancelMsgType:
+                loadRaw(b.quantities[i], d, 19);
+                break;
+            case OrderReplaceMsgType:
+                loadRaw(b.newOrderIds[i], d, 19);
+                loadRaw(b.quantities[i], d, 27);
+                loadRaw(b.prices[i], d, 31);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void BatchDecoder::flush(OrderColumns& b) {
+        const SwapKernels& k = kernels();
+        const size_t n = b.count;
+
+        k.swap16(b.locates, n);
+        k.swap64(b.timestamps, n);
+        for (size_t i = 0; i < n; ++i) b.timestamps[i] &= TIMESTAMP_MASK;
+        k.swap64(b.orderIds, n);
+
+        switch (b.type) {
+            case AddOrderMsgType:
+            case TradeMsgType:
+                k.swap32(b.quantities, n);
+                k.swap32(b.prices, n);
+                break;
+            case OrderExecutedMsgType:
+            case OrderCancelMsgType:
+                k.swap32(b.quantities, n);
+                break;
+            case OrderReplaceMsgType:
+                k.swap64(b.newOrderIds, n);
+                k.swap32(b.quantities, n);
+                k.swap32(b.prices, n);
+                break;
+            default:
+                break;
+        }
+
+        onBatch(b);
+        b.count = 0;
+    }
+
+}
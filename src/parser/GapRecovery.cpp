@@ -0,0 +1,335 @@
+#include "../../include/parser/GapRecovery.hpp"
+#include "../../include/parser/ItchReaders.hpp"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace ITCH {
+
+    namespace {
+        // Single writer, so a plain load and store is enough and keeps the hot path free of locked adds
+        void add(std::atomic<uint64_t>& counter, uint64_t n = 1) {
+            counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        void raise(std::atomic<uint64_t>& counter, uint64_t value) {
+            if (value > counter.load(std::memory_order_relaxed)) counter.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    GapRecovery::GapRecovery(MoldUdp64Session& session, const char* serverHost, uint16_t serverPort,
+                             const RecoveryConfig& config)
+        : session(session), config(config), fd(socket(AF_INET, SOCK_DGRAM, 0)), held(config.holdPackets) {
+
+        if (fd == -1) {
+            throw std::runtime_error("Failed to create recovery socket");
+        }
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(serverPort);
+        addr.sin_addr.s_addr = inet_addr(serverHost);
+
+        // Connected, so the socket only ever sees the server's retransmissions
+        if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+            close(fd);
+            throw std::runtime_error("Failed to connect to rerequest server " + std::string(serverHost));
+        }
+
+        int rcvbuf = 8 << 20;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+        for (HeldPacket& slot : held) slot.used = false;
+        TscClock::calibrate();
+    }
+
+    GapRecovery::~GapRecovery() {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+
+    RecoveryStats GapRecovery::stats() const {
+        auto get = [](const std::atomic<uint64_t>& counter) { return counter.load(std::memory_order_relaxed); };
+        return {
+            .gapsDetected = get(counters.gapsDetected),
+            .gapsRecovered = get(counters.gapsRecovered),
+            .gapsAbandoned = get(counters.gapsAbandoned),
+            .messagesRecovered = get(counters.messagesRecovered),
+            .messagesLost = get(counters.messagesLost),
+            .requestsSent = get(counters.requestsSent),
+            .heldPackets = get(counters.heldPackets),
+            .maxHeldPackets = get(counters.maxHeldPackets),
+            .holdOverflows = get(counters.holdOverflows),
+            .lastRecoveryNs = get(counters.lastRecoveryNs),
+            .maxRecoveryNs = get(counters.maxRecoveryNs),
+            .totalRecoveryNs = get(counters.totalRecoveryNs),
+        };
+    }
+
+    void GapRecovery::onPacket(const char* data, size_t len) {
+        handle(data, len, false);
+    }
+
+    void GapRecovery::handle(const char* data, size_t len, bool retransmission) {
+        MoldHeader header;
+        if (!readMoldHeader(data, len, header)) return;
+
+        std::memcpy(sessionName, header.session, MOLD_SESSION_SIZE);
+
+        if (header.count == MOLD_END_OF_SESSION) {
+            sessionEnded = true;
+            // It carries the next sequence number, so a lost final packet is a gap like any other
+            if (session.expectedSequence() != 0 && header.sequence > session.expectedSequence()) {
+                gapEnd = std::max(gapEnd, header.sequence);
+                if (!gapOpen) openGap();
+            }
+            return;
+        }
+
+        if (session.expectedSequence() == 0) session.setExpectedSequence(header.sequence);
+
+        // Ahead of the stream: park it and make sure the hole in front of it is being requested
+        if (header.sequence > session.expectedSequence()) {
+            gapEnd = std::max(gapEnd, header.sequence);
+
+            if (!gapOpen) openGap();
+
+            if (header.count != 0) {
+                while (!hold(header, data, len)) {
+                    add(counters.holdOverflows);
+                    abandon();
+                    if (header.sequence <= session.expectedSequence()) {
+                        handle(data, len, retransmission);
+                        return;
+                    }
+                }
+            }
+            return;
+        }
+
+        if (header.count == 0) return;
+
+        const uint64_t before = session.delivered();
+        session.deliver(data + MOLD_HEADER_SIZE, len - MOLD_HEADER_SIZE, header.sequence, header.count);
+        const uint64_t delivered = session.delivered() - before;
+
+        drain();
+
+        if (retransmission && delivered) {
+            add(counters.messagesRecovered, delivered);
+            // Progress, ask for the rest of a gap wider than one request straight away
+            if (gapOpen && session.expectedSequence() < gapEnd) {
+                retries = 0;
+                request();
+            }
+        }
+
+        closeGapIfFilled();
+    }
+
+    bool GapRecovery::hold(const MoldHeader& header, const char* data, size_t len) {
+        if (len > sizeof(HeldPacket::data)) return false;
+
+        for (HeldPacket& slot : held) {
+            if (slot.used) continue;
+            slot.used = true;
+            slot.seq = header.sequence;
+            slot.count = header.count;
+            slot.len = static_cast<uint16_t>(len);
+            std::memcpy(slot.data, data, len);
+
+            counters.heldPackets.store(++parked, std::memory_order_relaxed);
+            raise(counters.maxHeldPackets, parked);
+            return true;
+        }
+        return false;
+    }
+
+    void GapRecovery::drain() {
+        bool progress = true;
+        while (progress && parked) {
+            progress = false;
+            for (HeldPacket& slot : held) {
+                if (!slot.used || slot.seq > session.expectedSequence()) continue;
+
+                session.deliver(slot.data + MOLD_HEADER_SIZE, slot.len - MOLD_HEADER_SIZE, slot.seq, slot.count);
+                slot.used = false;
+                counters.heldPackets.store(--parked, std::memory_order_relaxed);
+                progress = true;
+            }
+        }
+    }
+
+    void GapRecovery::closeGapIfFilled() {
+        if (!gapOpen || session.expectedSequence() < gapEnd) return;
+
+        gapOpen = false;
+        const uint64_t recoveryNs = TscClock::toNs(TscClock::now() - gapStartTsc);
+        add(counters.gapsRecovered);
+        counters.lastRecoveryNs.store(recoveryNs, std::memory_order_relaxed);
+        raise(counters.maxRecoveryNs, recoveryNs);
+        add(counters.totalRecoveryNs, recoveryNs);
+
+        reopenIfHeld();
+    }
+
+    void GapRecovery::reopenIfHeld() {
+        // Whatever is still parked sits behind a further hole
+        if (parked) openGap();
+    }
+
+    void GapRecovery::openGap() {
+        gapOpen = true;
+        add(counters.gapsDetected);
+        gapStartTsc = TscClock::now();
+        retries = 0;
+        request();
+    }
+
+    void GapRecovery::abandon() {
+        uint64_t resume = gapEnd;
+        for (const HeldPacket& slot : held) {
+            if (slot.used) resume = std::min(resume, slot.seq);
+        }
+
+        if (resume > session.expectedSequence()) {
+            add(counters.messagesLost, resume - session.expectedSequence());
+            session.setExpectedSequence(resume);
+        }
+
+        gapOpen = false;
+        add(counters.gapsAbandoned);
+        drain();
+        reopenIfHeld();
+    }
+
+    void GapRecovery::request() {
+        const uint64_t from = session.expectedSequence();
+        const uint64_t count = std::min<uint64_t>(gapEnd - from, config.maxRequestCount);
+        if (count == 0) return;
+
+        char packet[MOLD_HEADER_SIZE];
+        std::memcpy(packet, sessionName, MOLD_SESSION_SIZE);
+        uint64_t seq = htobe64(from);
+        uint16_t n = htobe16(static_cast<uint16_t>(count));
+        std::memcpy(packet + 10, &seq, 8);
+        std::memcpy(packet + 18, &n, 2);
+
+        send(fd, packet, sizeof(packet), 0);
+        add(counters.requestsSent);
+        lastRequestTsc = TscClock::now();
+    }
+
+    void GapRecovery::service() {
+        char buffer[65536];
+        ssize_t n;
+        while ((n = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+            handle(buffer, static_cast<size_t>(n), true);
+        }
+
+        if (!gapOpen) return;
+
+        if (TscClock::now() - lastRequestTsc > TscClock::toTicks(config.retryTimeoutNs)) {
+            if (retries >= config.maxRetries) {
+                abandon();
+            } else {
+                ++retries;
+                request();
+            }
+        }
+    }
+
+    void GapRecovery::run(UdpReader& live, const std::atomic<bool>& running) {
+        const char* data;
+        size_t len;
+        while (running.load(std::memory_order_relaxed) && !(sessionEnded && !gapOpen)) {
+            if (live.receive(data, len, 1)) onPacket(data, len);
+            service();
+        }
+    }
+
+    RerequestServer::RerequestServer(const char* itchFile, uint16_t port, std::string_view session)
+        : reader(itchFile), fd(socket(AF_INET, SOCK_DGRAM, 0)), boundPort(0), builder(session) {
+
+        if (fd == -1) {
+            throw std::runtime_error("Failed to create rerequest socket");
+        }
+
+        while (const char* raw = reader.nextMsg()) {
+            messages.push_back(raw);
+        }
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+            close(fd);
+            throw std::runtime_error("Failed to bind rerequest port " + std::to_string(port));
+        }
+
+        socklen_t addrLen = sizeof(addr);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &addrLen);
+        boundPort = ntohs(addr.sin_port);
+    }
+
+    RerequestServer::~RerequestServer() {
+        stop();
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+
+    void RerequestServer::start() {
+        if (running.exchange(true)) return;
+        worker = std::thread(&RerequestServer::serve, this);
+    }
+
+    void RerequestServer::stop() {
+        running = false;
+        if (worker.joinable()) worker.join();
+    }
+
+    void RerequestServer::serve() {
+        char request[64];
+        while (running.load(std::memory_order_relaxed)) {
+            pollfd pfd{fd, POLLIN, 0};
+            if (::poll(&pfd, 1, 10) <= 0) continue;
+
+            sockaddr_in from{};
+            socklen_t fromLen = sizeof(from);
+            ssize_t n = recvfrom(fd, request, sizeof(request), 0, reinterpret_cast<sockaddr*>(&from), &fromLen);
+            if (n < static_cast<ssize_t>(MOLD_HEADER_SIZE)) continue;
+
+            const uint64_t first = readU64(request, 10);
+            const uint64_t last = std::min<uint64_t>(first + readU16(request, 18), messages.size() + 1);
+
+            auto flush = [&] {
+                sendto(fd, builder.data(), builder.size(), 0, reinterpret_cast<sockaddr*>(&from), fromLen);
+                builder.reset(builder.nextSequence());
+            };
+
+            builder.reset(std::max<uint64_t>(first, 1));
+            for (uint64_t seq = std::max<uint64_t>(first, 1); seq < last; ++seq) {
+                const char* raw = messages[seq - 1];
+                const uint16_t msgLength = readU16(raw - 2, 0);
+                if (!builder.add(raw, msgLength)) {
+                    flush();
+                    builder.add(raw, msgLength);
+                }
+            }
+            if (builder.count()) flush();
+
+            served.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+}
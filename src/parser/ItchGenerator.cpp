@@ -0,0 +1,548 @@
+#include "../../include/parser/ItchGenerator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <endian.h>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace ITCH {
+
+    namespace {
+        constexpr uint64_t NS_PER_HOUR = 3'600'000'000'000;
+        constexpr uint64_t START_OF_MESSAGES = 3 * NS_PER_HOUR;
+        constexpr uint64_t START_OF_SYSTEM = 4 * NS_PER_HOUR;
+        constexpr uint64_t MARKET_OPEN = 9 * NS_PER_HOUR + NS_PER_HOUR / 2;
+        constexpr uint64_t MARKET_CLOSE = 16 * NS_PER_HOUR;
+        constexpr uint64_t END_OF_SYSTEM = 20 * NS_PER_HOUR;
+
+        constexpr uint64_t NEVER = UINT64_MAX / 2;
+        constexpr uint32_t CROSS_SYMBOLS = 100;     // most active symbols get an opening and closing cross
+
+        void put16(char* p, uint16_t v) { v = htobe16(v); std::memcpy(p, &v, 2); }
+        void put32(char* p, uint32_t v) { v = htobe32(v); std::memcpy(p, &v, 4); }
+        void put64(char* p, uint64_t v) { v = htobe64(v); std::memcpy(p, &v, 8); }
+        void put48(char* p, uint64_t v) { put16(p, static_cast<uint16_t>(v >> 32)); put32(p + 2, static_cast<uint32_t>(v)); }
+    }
+
+    ItchGenerator::ItchGenerator(const GeneratorConfig& config)
+        : config(config), state(config.seed ^ 0x9E3779B97F4A7C15ull), timestamp(START_OF_MESSAGES), meanGapNs(1) {
+
+        if (config.symbols == 0 || config.symbols > UINT16_MAX) {
+            throw std::invalid_argument("Generator needs between 1 and 65535 symbols");
+        }
+    }
+
+    std::vector<char> ItchGenerator::generate() {
+        std::vector<char> buffer;
+        buffer.reserve(config.messages * 36);
+        out = &buffer;
+
+        counters = {};
+        live = {};
+        state = config.seed ^ 0x9E3779B97F4A7C15ull;
+        timestamp = START_OF_MESSAGES;
+        nextOrderRef = 1;
+        nextMatch = 1;
+        lastTrade = 0;
+
+        setupSymbols();
+        directory();
+
+        // Two closing system events still to come
+        const uint64_t used = counters.messages + 2;
+        orderFlow(config.messages > used ? config.messages - used : 0);
+        closing();
+
+        counters.ordersOpenAtEnd += live.size();
+        out = nullptr;
+        return buffer;
+    }
+
+    GeneratorStats ItchGenerator::writeFile(const char* path) {
+        const std::vector<char> buffer = generate();
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("Failed to create " + std::string(path));
+        }
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        if (!file) {
+            throw std::runtime_error("Failed to write " + std::string(path));
+        }
+        return counters;
+    }
+
+    uint64_t ItchGenerator::nextU64() {
+        // splitmix64
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    double ItchGenerator::uniform() {
+        return static_cast<double>(nextU64() >> 11) * 0x1.0p-53;
+    }
+
+    uint64_t ItchGenerator::below(uint64_t n) {
+        return static_cast<uint64_t>(uniform() * static_cast<double>(n));
+    }
+
+    uint64_t ItchGenerator::exponential(double mean) {
+        return static_cast<uint64_t>(-std::log1p(-uniform()) * mean);
+    }
+
+    uint16_t ItchGenerator::pickSymbol() {
+        const double u = uniform() * symbolCdf.back();
+        const size_t i = std::upper_bound(symbolCdf.begin(), symbolCdf.end(), u) - symbolCdf.begin();
+        return static_cast<uint16_t>(std::min<size_t>(i, symbols.size() - 1) + 1);
+    }
+
+    void ItchGenerator::setupSymbols() {
+        symbols.assign(config.symbols, {});
+        symbolCdf.assign(config.symbols, 0.0);
+
+        double total = 0.0;
+        for (uint32_t i = 0; i < config.symbols; ++i) {
+            Symbol& s = symbols[i];
+
+            // Four or five letters, padded with spaces like the real directory
+            std::memset(s.ticker, ' ', sizeof(s.ticker));
+            uint32_t n = i;
+            const size_t letters = i < 26 * 26 * 26 * 26 ? 4 : 5;
+            for (size_t c = letters; c-- > 0; n /= 26) s.ticker[c] = static_cast<char>('A' + n % 26);
+
+            // Log-uniform between $2 and $400, penny ticks
+            const double dollars = std::exp(std::log(2.0) + uniform() * (std::log(400.0) - std::log(2.0)));
+            s.tick = 100;
+            s.mid = std::max<uint32_t>(static_cast<uint32_t>(dollars * 100.0) * s.tick, 10 * s.tick);
+
+            total += 1.0 / std::pow(static_cast<double>(i + 1), config.symbolSkew);
+            symbolCdf[i] = total;
+        }
+    }
+
+    void ItchGenerator::directory() {
+        systemEvent('O');
+
+        for (uint16_t locate = 1; locate <= symbols.size(); ++locate) {
+            timestamp += 1000;
+            stockDirectory(locate);
+            tradingAction(locate, 'T');
+            if (below(10) == 0) regSho(locate);
+            if (below(20) == 0) participantPosition(locate);
+        }
+        mwcbDecline();
+
+        timestamp = std::max(timestamp, START_OF_SYSTEM);
+        systemEvent('S');
+    }
+
+    void ItchGenerator::orderFlow(uint64_t budget) {
+        const uint64_t first = counters.messages;
+        const uint64_t last = first + budget;
+        meanGapNs = std::max<uint64_t>((END_OF_SYSTEM - START_OF_SYSTEM) / std::max<uint64_t>(budget, 1), 1);
+
+        bool open = false;
+        bool closed = false;
+        while (counters.messages < last) {
+            timestamp += exponential(static_cast<double>(meanGapNs)) + 1;
+
+            if (!open && timestamp >= MARKET_OPEN) {
+                open = true;
+                systemEvent('Q');
+                for (uint16_t locate = 1; locate <= std::min<size_t>(CROSS_SYMBOLS, symbols.size()) && counters.messages < last; ++locate) {
+                    crossTrade(locate);
+                }
+                // Rare types show up at least once however short the session
+                if (counters.messages + 8 < last) {
+                    const uint16_t locate = pickSymbol();
+                    noii(locate);
+                    retailInterest(locate);
+                    operationalHalt(locate);
+                    ipoUpdate(locate);
+                    luldCollar(locate);
+                    directListing(locate);
+                    brokenTrade(locate);
+                    mwcbStatus();
+                }
+                continue;
+            }
+            if (!closed && timestamp >= MARKET_CLOSE) {
+                closed = true;
+                systemEvent('M');
+                for (uint16_t locate = 1; locate <= std::min<size_t>(CROSS_SYMBOLS, symbols.size()) && counters.messages < last; ++locate) {
+                    crossTrade(locate);
+                }
+                continue;
+            }
+
+            if (!live.empty() && live.top().due <= counters.messages) {
+                Order order = live.top();
+                live.pop();
+                finish(order);
+                continue;
+            }
+
+            const double u = uniform();
+            if (u < 0.90) {
+                addOrder(pickSymbol());
+            } else if (u < 0.95) {
+                trade(pickSymbol());
+            } else if (u < 0.99) {
+                noii(pickSymbol());
+            } else {
+                admin(pickSymbol());
+            }
+        }
+    }
+
+    void ItchGenerator::closing() {
+        timestamp = std::max(timestamp, END_OF_SYSTEM);
+        systemEvent('E');
+        timestamp += 5 * 60'000'000'000ull;
+        systemEvent('C');
+    }
+
+    uint64_t ItchGenerator::lifetime() {
+        const double u = uniform();
+        if (u < config.shortLived) return exponential(static_cast<double>(config.shortLifetime)) + 1;
+        if (u < 1.0 - config.longLived) return exponential(static_cast<double>(config.intradayLifetime)) + 1;
+        return NEVER;
+    }
+
+    void ItchGenerator::pushLive(const Order& o) {
+        // All day orders never come up for a decision, keep them out of the heap
+        if (o.due >= NEVER) {
+            ++counters.ordersOpenAtEnd;
+            return;
+        }
+        live.push(o);
+    }
+
+    uint32_t ItchGenerator::quotePrice(const Symbol& s, char side) {
+        // Most orders join at or near the touch, a thin tail rests deep in the book
+        const uint32_t ticks = static_cast<uint32_t>(std::min<uint64_t>(exponential(3.0), 200));
+        if (side == 'B') {
+            const uint32_t away = (ticks + 1) * s.tick;
+            return s.mid > away + s.tick ? s.mid - away : s.tick;
+        }
+        return s.mid + (ticks + 1) * s.tick;
+    }
+
+    void ItchGenerator::addOrder(uint16_t locate) {
+        const Symbol& s = symbols[locate - 1];
+
+        Order o;
+        o.ref = nextOrderRef++;
+        o.locate = locate;
+        o.side = below(2) ? 'B' : 'S';
+        o.price = quotePrice(s, o.side);
+        o.shares = static_cast<uint32_t>(100 * (1 + std::min<uint64_t>(exponential(2.0), 99)));
+        o.attributed = below(50) == 0;
+        o.due = counters.messages + lifetime();
+
+        add(o);
+        ++counters.ordersAdded;
+        pushLive(o);
+    }
+
+    void ItchGenerator::finish(Order o) {
+        const double u = uniform();
+
+        if (u < 0.72) {
+            remove(o);
+            return;
+        }
+
+        if (u < 0.87) {
+            Order replacement = o;
+            replacement.ref = nextOrderRef++;
+            replacement.price = quotePrice(symbols[o.locate - 1], o.side);
+            if (below(4) == 0) replacement.shares = static_cast<uint32_t>(100 * (1 + below(10)));
+            replacement.due = counters.messages + lifetime();
+
+            replace(o, replacement);
+            pushLive(replacement);
+            return;
+        }
+
+        // Partial fills and partial cancels leave the rest of the order resting a little longer
+        const bool full = o.shares <= 100 || below(2) == 0;
+        const uint32_t shares = full ? o.shares : static_cast<uint32_t>(100 * (1 + below(o.shares / 100 - 1)));
+
+        if (u < 0.96) {
+            if (below(10) == 0) {
+                executedWithPrice(o, shares, o.price);
+            } else {
+                executed(o, shares);
+            }
+            Symbol& s = symbols[o.locate - 1];
+            s.mid = o.price;
+        } else {
+            if (full) {
+                remove(o);
+                return;
+            }
+            cancel(o, shares);
+        }
+
+        if (!full) {
+            o.shares -= shares;
+            o.due = counters.messages + lifetime();
+            pushLive(o);
+        }
+    }
+
+    void ItchGenerator::admin(uint16_t locate) {
+        const uint64_t pick = below(100);
+        if (pick < 30) {
+            retailInterest(locate);
+        } else if (pick < 40) {
+            operationalHalt(locate);
+        } else if (pick < 50) {
+            ipoUpdate(locate);
+        } else if (pick < 65) {
+            luldCollar(locate);
+        } else if (pick < 70) {
+            directListing(locate);
+        } else if (pick < 80) {
+            brokenTrade(locate);
+        } else if (pick < 82) {
+            mwcbStatus();
+        } else if (pick < 90) {
+            tradingAction(locate, below(2) ? 'H' : 'T');
+        } else {
+            crossTrade(locate);
+        }
+    }
+
+    char* ItchGenerator::frame(msg_type type, uint16_t locate) {
+        const uint16_t size = MsgSizeTable[static_cast<uint8_t>(type)];
+        const size_t at = out->size();
+        out->resize(at + 2 + size);
+
+        char* p = out->data() + at;
+        put16(p, size);
+        char* m = p + 2;
+        m[0] = type;
+        put16(m + 1, locate);
+        put16(m + 3, 0);
+        put48(m + 5, timestamp);
+
+        ++counters.messages;
+        counters.bytes += 2 + size;
+        ++counters.perType[static_cast<uint8_t>(type)];
+        return m;
+    }
+
+    void ItchGenerator::systemEvent(char code) {
+        char* m = frame(SystemEventMsgType, 0);
+        m[11] = code;
+    }
+
+    void ItchGenerator::stockDirectory(uint16_t locate) {
+        const Symbol& s = symbols[locate - 1];
+        char* m = frame(StockDirectoryMsgType, locate);
+        std::memcpy(m + 11, s.ticker, 8);
+        m[19] = "QGSNAPZ"[below(7)];    // market category
+        m[20] = 'N';                    // financial status
+        put32(m + 21, 100);             // round lot size
+        m[25] = 'N';
+        m[26] = 'C';                    // issue classification
+        m[27] = 'Z';
+        m[28] = ' ';
+        m[29] = 'P';                    // production
+        m[30] = 'N';                    // short sale threshold
+        m[31] = ' ';
+        m[32] = below(4) ? '2' : '1';   // LULD tier
+        m[33] = 'N';
+        put32(m + 34, 0);
+        m[38] = 'N';
+    }
+
+    void ItchGenerator::tradingAction(uint16_t locate, char state) {
+        const Symbol& s = symbols[locate - 1];
+        char* m = frame(StockTradingActionMsgType, locate);
+        std::memcpy(m + 11, s.ticker, 8);
+        m[19] = state;
+        m[20] = ' ';
+        std::memcpy(m + 21, state == 'H' ? "LUDP" : "    ", 4);
+    }
+
+    void ItchGenerator::regSho(uint16_t locate) {
+        const Symbol& s = symbols[locate - 1];
+        char* m = frame(RegSHORestrictionMsgType, locate);
+        std::memcpy(m + 11, s.ticker, 8);
+        m[19] = '0';
+    }
+
+    void ItchGenerator::participantPosition(uint16_t locate) {
+        const Symbol& s = symbols[locate - 1];
+        char* m = frame(MarketParticipantPositionMsgType, locate);
+        std::memcpy(m + 11, "MMKR", 4);
+        std::memcpy(m + 15, s.ticker, 8);
+        m[23] = 'Y';
+        m[24] = 'N';
+        m[25] = 'A';
+    }
+
+    void ItchGenerator::mwcbDecline() {
+        char* m = frame(MWCBDeclineLevelMsgType, 0);
+        // Eight implied decimals
+        put64(m + 11, 3'500'00000000ull);
+        put64(m + 19, 3'250'00000000ull);
+        put64(m + 27, 2'900'00000000ull);
+    }
+
+    void ItchGenerator::mwcbStatus() {
+        char* m = frame(MWCBStatusMsgType, 0);
+        m[11] = '1';
+    }
+
+    void ItchGenerator::ipoUpdate(uint16_t locate) {
+        const Symbol& s = symbols[locate - 1];
+        char* m = frame(IPOQuotingPeriodUpdateMsgType, locate);
+        std::memcpy(m + 11, s.ticker, 8);
+        put32(m + 19, 12 * 3600);   // release time, seconds since midnight
+        m[23] = 'A';
+        put32(m + 24, s.mid);
+    }
+
+    void ItchGenerator::luldCollar(uint16_t locate) {
+        const Symbol& s = symbols[locate - 1];
+        char* m = frame(LULDAuctionCollarMsgType, locate);
+        std::memcpy(m + 11, s.ticker, 8);
+        put32(m + 19, s.mid);
+        put32(m + 23, s.mid + s.mid / 10);
+        put32(m + 27, s.mid - s.mid / 10);
+        put32(m + 31, 0);
+    }
+
+    void ItchGenerator::operationalHalt(uint16_t locate) {
+        const Symbol& s = symbols[locate - 1];
+        char* m = frame(OperationalHaltMsgType, locate);
+        std::memcpy(m + 11, s.ticker, 8);
+        m[19] = 'Q';
+        m[20] = below(2) ? 'H' : 'T';
+    }
+
+    void ItchGenerator::add(const Order& o) {
+        char* m = frame(o.attributed ? AddOrderMPIDAttributionMsgType : AddOrderMsgType, o.locate);
+        put64(m + 11, o.ref);
+        m[19] = o.side;
+        put32(m + 20, o.shares);
+        std::memcpy(m + 24, symbols[o.locate - 1].ticker, 8);
+        put32(m + 32, o.price);
+        if (o.attributed) std::memcpy(m + 36, "MMKR", 4);
+    }
+
+    void ItchGenerator::executed(const Order& o, uint32_t shares) {
+        char* m = frame(OrderExecutedMsgType, o.locate);
+        put64(m + 11, o.ref);
+        put32(m + 19, shares);
+        lastTrade = nextMatch;
+        put64(m + 23, nextMatch++);
+    }
+
+    void ItchGenerator::executedWithPrice(const Order& o, uint32_t shares, uint32_t price) {
+        char* m = frame(OrderExecutedWithPriceMsgType, o.locate);
+        put64(m + 11, o.ref);
+        put32(m + 19, shares);
+        lastTrade = nextMatch;
+        put64(m + 23, nextMatch++);
+        m[31] = 'Y';
+        put32(m + 32, price);
+    }
+
+    void ItchGenerator::cancel(const Order& o, uint32_t shares) {
+        char* m = frame(OrderCancelMsgType, o.locate);
+        put64(m + 11, o.ref);
+        put32(m + 19, shares);
+    }
+
+    void ItchGenerator::remove(const Order& o) {
+        char* m = frame(OrderDeleteMsgType, o.locate);
+        put64(m + 11, o.ref);
+    }
+
+    void ItchGenerator::replace(const Order& o, const Order& replacement) {
+        char* m = frame(OrderReplaceMsgType, o.locate);
+        put64(m + 11, o.ref);
+        put64(m + 19, replacement.ref);
+        put32(m + 27, replacement.shares);
+        put32(m + 31, replacement.price);
+    }
+
+    void ItchGenerator::trade(uint16_t locate) {
+        Symbol& s = symbols[locate - 1];
+        char* m = frame(TradeMsgType, locate);
+        put64(m + 11, 0);
+        m[19] = 'B';
+        put32(m + 20, static_cast<uint32_t>(100 * (1 + below(5))));
+        std::memcpy(m + 24, s.ticker, 8);
+        put32(m + 32, s.mid);
+        lastTrade = nextMatch;
+        put64(m + 36, nextMatch++);
+
+        // Hidden liquidity trades nudge the mid a tick
+        if (below(2)) {
+            s.mid += s.tick;
+        } else if (s.mid > 10 * s.tick) {
+            s.mid -= s.tick;
+        }
+    }
+
+    void ItchGenerator::crossTrade(uint16_t locate) {
+        const Symbol& s = symbols[locate - 1];
+        char* m = frame(CrossTradeMsgType, locate);
+        put64(m + 11, 1000 * (1 + below(1000)));
+        std::memcpy(m + 19, s.ticker, 8);
+        put32(m + 27, s.mid);
+        lastTrade = nextMatch;
+        put64(m + 31, nextMatch++);
+        m[39] = timestamp < MARKET_CLOSE ? 'O' : 'C';
+    }
+
+    void ItchGenerator::brokenTrade(uint16_t locate) {
+        char* m = frame(BrokenTradeMsgType, locate);
+        put64(m + 11, lastTrade ? 1 + below(lastTrade) : 0);
+    }
+
+    void ItchGenerator::noii(uint16_t locate) {
+        const Symbol& s = symbols[locate - 1];
+        char* m = frame(NOIIMessageMsgType, locate);
+        put64(m + 11, 100 * below(10000));
+        put64(m + 19, 100 * below(1000));
+        m[27] = "BSNO"[below(4)];
+        std::memcpy(m + 28, s.ticker, 8);
+        put32(m + 36, s.mid);
+        put32(m + 40, s.mid);
+        put32(m + 44, s.mid);
+        m[48] = timestamp < MARKET_CLOSE ? 'O' : 'C';
+        m[49] = 'L';
+    }
+
+    void ItchGenerator::retailInterest(uint16_t locate) {
+        const Symbol& s = symbols[locate - 1];
+        char* m = frame(RetailInterestMsgType, locate);
+        std::memcpy(m + 11, s.ticker, 8);
+        m[19] = "BSAN"[below(4)];
+    }
+
+    void ItchGenerator::directListing(uint16_t locate) {
+        const Symbol& s = symbols[locate - 1];
+        char* m = frame(DirectListingWithCRPDMsgType, locate);
+        std::memcpy(m + 11, s.ticker, 8);
+        m[19] = 'Y';
+        put32(m + 20, s.mid - s.mid / 5);
+        put32(m + 24, s.mid + s.mid / 5);
+        put32(m + 28, s.mid);
+        put64(m + 32, timestamp);
+        put32(m + 40, s.mid - s.mid / 10);
+        put32(m + 44, s.mid + s.mid / 10);
+    }
+
+}
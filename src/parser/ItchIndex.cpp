@@ -0,0 +1,128 @@
+#include "../../include/parser/ItchIndex.hpp"
+#include "../../include/parser/ItchParser.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace ITCH {
+
+    OffsetIndex::OffsetIndex(const char* indexFile)
+        : fd(open(indexFile, O_RDONLY)), start(nullptr), length(0), header(nullptr), entries(nullptr) {
+
+        if (fd == -1) {
+            throw std::runtime_error("Failed to open index: " + std::string(indexFile));
+        }
+
+        struct stat sb;
+        if (fstat(fd, &sb) == -1) {
+            close(fd);
+            throw std::runtime_error("Failed to get index stats");
+        }
+        length = sb.st_size;
+
+        if (length < sizeof(IndexHeader)) {
+            close(fd);
+            throw std::runtime_error("Index too small: " + std::string(indexFile));
+        }
+
+        start = static_cast<char*>(mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0));
+        if (start == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Failed to mmap index");
+        }
+
+        header = reinterpret_cast<const IndexHeader*>(start);
+        entries = reinterpret_cast<const IndexEntry*>(start + sizeof(IndexHeader));
+
+        auto malformed = [&](const char* why) {
+            munmap(start, length);
+            close(fd);
+            return std::runtime_error("Malformed index (" + std::string(why) + "): " + std::string(indexFile));
+        };
+
+        // entryCount is compared against what fits rather than multiplied, so it cannot overflow
+        if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION) throw malformed("header");
+        if (header->stride == 0) throw malformed("stride 0");
+        if (header->entryCount > (length - sizeof(IndexHeader)) / sizeof(IndexEntry)) throw malformed("truncated");
+
+        // seekTo* trust these: a checkpoint on every stride'th message, inside the indexed file
+        for (uint64_t i = 0; i < header->entryCount; ++i) {
+            if (entries[i].msgNumber != i * header->stride || entries[i].msgNumber >= header->msgCount) {
+                throw malformed("checkpoint numbering");
+            }
+            if (entries[i].offset >= header->fileSize) throw malformed("offset past end of file");
+        }
+    }
+
+    OffsetIndex::~OffsetIndex() {
+        if (start != MAP_FAILED && start != nullptr) {
+            munmap(start, length);
+        }
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+
+    void OffsetIndex::build(const char* itchFile, const char* indexFile, uint32_t stride) {
+        if (stride == 0) stride = DEFAULT_STRIDE;
+
+        MmapReader reader(itchFile);
+        std::vector<IndexEntry> checkpoints;
+
+        uint64_t msgNumber = 0;
+        uint64_t offset = reader.offset();
+        while (const char* raw = reader.nextMsg()) {
+            if (msgNumber % stride == 0) {
+                checkpoints.push_back({msgNumber, MmapReader::getDataTimestamp(raw), offset});
+            }
+            ++msgNumber;
+            offset = reader.offset();
+        }
+
+        IndexHeader hdr{};
+        std::memcpy(hdr.magic, MAGIC, sizeof(MAGIC));
+        hdr.version = VERSION;
+        hdr.stride = stride;
+        hdr.fileSize = reader.size();
+        hdr.msgCount = msgNumber;
+        hdr.entryCount = checkpoints.size();
+
+        std::ofstream out(indexFile, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Failed to create index: " + std::string(indexFile));
+        }
+        out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+        out.write(reinterpret_cast<const char*>(checkpoints.data()), checkpoints.size() * sizeof(IndexEntry));
+        if (!out) {
+            throw std::runtime_error("Failed to write index: " + std::string(indexFile));
+        }
+    }
+
+    std::string OffsetIndex::sidecarPath(const char* itchFile) {
+        return std::string(itchFile) + ".idx";
+    }
+
+    const IndexEntry& OffsetIndex::atMessage(uint64_t msgNumber) const {
+        if (size() == 0) throw std::runtime_error("Index is empty");
+
+        // Checkpoints sit on every stride'th message so this is a direct lookup
+        size_t i = std::min<uint64_t>(msgNumber / stride(), size() - 1);
+        return entries[i];
+    }
+
+    const IndexEntry& OffsetIndex::atTimestamp(ts timestamp) const {
+        if (size() == 0) throw std::runtime_error("Index is empty");
+
+        // ITCH timestamps never decrease through the file
+        const IndexEntry* it = std::lower_bound(entries, entries + size(), timestamp,
+            [](const IndexEntry& e, ts t) { return e.timestamp < t; });
+        return it == entries ? entries[0] : *(it - 1);
+    }
+
+}
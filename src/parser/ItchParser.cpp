@@ -1,4 +1,6 @@
 #include "../../include/parser/ItchParser.hpp"
+#include "../../include/parser/BatchDecoder.hpp"
+#include "../../include/parser/ItchReaders.hpp"
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -6,39 +8,14 @@
 #include <cstring>
 #include <arpa/inet.h>
 #include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <algorithm>
 
 namespace ITCH {
 
-    inline constexpr uint8_t readU8(const char* data, size_t offset) {
-        return *reinterpret_cast<const uint8_t*>(data + offset);
-    }
-
-    inline constexpr char readChar(const char* data, size_t offset) {
-        return static_cast<char>(readU8(data, offset));
-    }
-
-    inline constexpr uint16_t readU16(const char* data, size_t offset) {
-        return be16toh(*reinterpret_cast<const uint16_t*>(data + offset));
-    }
-
-    inline constexpr uint32_t readU32(const char* data, size_t offset) {
-        return be32toh(*reinterpret_cast<const uint32_t*>(data + offset));
-    }
-
-    inline uint64_t readU48(const char* d, size_t off) {
-        return (uint64_t(readU16(d, off)) << 32) | readU32(d, off + 2);
-    }
-
-    inline constexpr uint64_t readU64(const char* data, size_t offset) {
-        return be64toh(*reinterpret_cast<const uint64_t*>(data + offset));
-    }
-
-    inline void copyBytes(void* dst, const char* data, size_t offset, size_t len) {
-        std::memcpy(dst, data + offset, len);
-    }
-
     MmapReader::MmapReader(const char* filename) 
-        : fd(open(filename, O_RDONLY)), start(nullptr), cursor(nullptr), end(nullptr) {
+        : fd(open(filename, O_RDONLY)), start(nullptr), cursor(nullptr), end(nullptr), msgNumber(0) {
         
         if (fd == -1) {
             throw std::runtime_error("Failed to open file: " + std::string(filename));
@@ -59,7 +36,7 @@ namespace ITCH {
         cursor = start;
         end = start + sb.st_size;
 
-        initDispatchTable();
+        rebuildTables();
     }
 
     MmapReader::~MmapReader() {
@@ -72,6 +49,7 @@ namespace ITCH {
     }
 
     void MmapReader::parse() {
+        checkPublishTarget(mode);
         while (const char* raw = nextMsg()) {
             msg_type type = getDataMessageType(raw);
             auto& handler = dispatchTable[static_cast<uint8_t>(type)];
@@ -84,86 +62,430 @@ namespace ITCH {
                 std::cerr << "Unknown message type: " << static_cast<int>(type) << "\n";
             }
         }
+        flushPublished();
+    }
+
+    void MmapReader::parseUntil(ts stop) {
+        checkPublishTarget(mode);
+        while (cursor + 2 + MSG_HEADER_SIZE <= end && getDataTimestamp(cursor + 2) < stop) {
+            const char* raw = nextMsg();
+            if (!raw) break;
+
+            auto& handler = dispatchTable[static_cast<uint8_t>(getDataMessageType(raw))];
+
+            [[likely]] if (handler) {
+                handler(raw);
+            }
+        }
+        flushPublished();
+    }
+
+    void MmapReader::parseBatched(BatchDecoder& decoder) {
+        BatchDecodeResult result = decoder.decode(cursor, end, msgNumber);
+        cursor = const_cast<char*>(result.stop);
+        msgNumber += result.frames;
+    }
+
+    ReplayStats MmapReader::replay(const ReplayConfig& config, const OffsetIndex* index) {
+        checkPublishTarget(mode);
+        ReplayStats stats;
+
+        if (index) {
+            seekToTimestamp(*index, config.startTimestamp);
+        } else {
+            while (cursor + 2 + MSG_HEADER_SIZE <= end && getDataTimestamp(cursor + 2) < config.startTimestamp) {
+                nextMsg();
+            }
+        }
+        if (cursor + 2 + MSG_HEADER_SIZE > end) return stats;
+
+        TscClock::calibrate();
+        const bool paced = config.speed > 0.0;
+        const double ticksPerItchNs = paced ? TscClock::ticksPerNs() / config.speed : 0.0;
+        const ts firstTimestamp = getDataTimestamp(cursor + 2);
+        const uint64_t tscStart = TscClock::now();
+
+        while (cursor + 2 + MSG_HEADER_SIZE <= end) {
+            const ts timestamp = getDataTimestamp(cursor + 2);
+            if (timestamp >= config.stopTimestamp) break;
+
+            const char* raw = nextMsg();
+            if (!raw) break;
+
+            if (paced) {
+                const uint64_t due = tscStart + static_cast<uint64_t>((timestamp - firstTimestamp) * ticksPerItchNs);
+                TscClock::waitUntil(due);
+
+                const uint64_t now = TscClock::now();
+                const uint64_t behindNs = now > due ? TscClock::toNs(now - due) : 0;
+                stats.maxBehindNs = std::max(stats.maxBehindNs, behindNs);
+                stats.totalBehindNs += behindNs;
+                stats.finalBehindNs = behindNs;
+                stats.lateMessages += behindNs > config.lateThresholdNs;
+            }
+
+            auto& handler = dispatchTable[static_cast<uint8_t>(getDataMessageType(raw))];
+
+            [[likely]] if (handler) {
+                handler(raw);
+            }
+            // Pacing is per message, so is publishing
+            flushPublished();
+            ++stats.messages;
+        }
+
+        stats.wallNs = TscClock::toNs(TscClock::now() - tscStart);
+        return stats;
+    }
+
+    void MmapReader::rewind() {
+        cursor = start;
+        msgNumber = 0;
+    }
+
+    bool MmapReader::seekToMessage(const OffsetIndex& index, uint64_t target) {
+        if (index.fileSize() != size()) {
+            throw std::runtime_error("Index does not match mapped file");
+        }
+
+        const IndexEntry& checkpoint = index.atMessage(target);
+        cursor = start + checkpoint.offset;
+        msgNumber = checkpoint.msgNumber;
+
+        while (msgNumber < target) {
+            if (!nextMsg()) return false;
+        }
+        return cursor < end;
+    }
+
+    bool MmapReader::seekToTimestamp(const OffsetIndex& index, ts timestamp) {
+        if (index.fileSize() != size()) {
+            throw std::runtime_error("Index does not match mapped file");
+        }
+
+        const IndexEntry& checkpoint = index.atTimestamp(timestamp);
+        cursor = start + checkpoint.offset;
+        msgNumber = checkpoint.msgNumber;
+
+        // At most one stride of frames between the checkpoint and the target
+        while (cursor + 2 + MSG_HEADER_SIZE <= end && getDataTimestamp(cursor + 2) < timestamp) {
+            if (!nextMsg()) return false;
+        }
+        return cursor + 2 + MSG_HEADER_SIZE <= end;
+    }
+
+    void MmapReader::setPublishMode(PublishMode newMode) {
+        checkPublishTarget(newMode);
+        mode = newMode;
+        rebuildTables();
+    }
+
+    void MmapReader::checkPublishTarget(PublishMode mode) {
+        // A FrameRef is a pointer into this process's mapping, garbage to a consumer anywhere else
+        if (mode == PublishMode::Reference && !shards_ && !byteRing_ && buffer_ && buffer_->fd() != -1) {
+            throw std::invalid_argument("Reference publish mode cannot publish into a shared memory queue");
+        }
+    }
+
+    void MmapReader::subscribe(const TypeMask& types) {
+        subscribed = types;
+        rebuildTables();
     }
 
-    void MmapReader::initDispatchTable() {
-        dispatchTable[SystemEventMsgType] = [](const char* data) {
+    void MmapReader::rebuildTables() {
+        dispatchTable = makeDispatchTable(mode, subscribed);
+
+        decodeTable = {};
+        initDecodeTable();
+        for (size_t t = 0; t < decodeTable.size(); ++t) {
+            if (!subscribed.test(static_cast<msg_type>(t))) decodeTable[t] = nullptr;
+        }
+    }
+
+    DispatchTable MmapReader::makeDispatchTable(PublishMode mode, const TypeMask& types) {
+        DispatchTable table = {};
+        initDispatchTable(table, mode);
+
+        // Unwanted but known types still need an entry so parse() does not report them as unknown
+        for (size_t t = 0; t < table.size(); ++t) {
+            if (table[t] && !types.test(static_cast<msg_type>(t))) {
+                table[t] = &skipMsg;
+            }
+        }
+        return table;
+    }
+
+    void MmapReader::initDispatchTable(DispatchTable& table, PublishMode mode) {
+        if (mode != PublishMode::Decoded) {
+            // Raw modes never decode, one entry serves every known type
+            DispatchTableEntry entry = mode == PublishMode::RawBytes ? &emitRawBytes : &emitFrameRef;
+            for (size_t t = 0; t < table.size(); ++t) {
+                if (MsgSizeTable[t]) table[t] = entry;
+            }
+            return;
+        }
+
+        table[SystemEventMsgType] = [](const char* data) {
             emitToBuffer(constructSystemEventMsg(data), SystemEventMsgType);
         };
-        dispatchTable[StockDirectoryMsgType] = [](const char* data) {
+        table[StockDirectoryMsgType] = [](const char* data) {
             emitToBuffer(constructStockDirectoryMsg(data), StockDirectoryMsgType);
         };
-        dispatchTable[StockTradingActionMsgType] = [](const char* data) {
+        table[StockTradingActionMsgType] = [](const char* data) {
             emitToBuffer(constructStockTradingActionMsg(data), StockTradingActionMsgType);
         };
-        dispatchTable[RegSHORestrictionMsgType] = [](const char* data) {
+        table[RegSHORestrictionMsgType] = [](const char* data) {
             emitToBuffer(constructRegSHORestrictionMsg(data), RegSHORestrictionMsgType);
         };
-        dispatchTable[MarketParticipantPositionMsgType] = [](const char* data) {
+        table[MarketParticipantPositionMsgType] = [](const char* data) {
             emitToBuffer(constructMarketParticipantPositionMsg(data), MarketParticipantPositionMsgType);
         };
-        dispatchTable[MWCBDeclineLevelMsgType] = [](const char* data) {
+        table[MWCBDeclineLevelMsgType] = [](const char* data) {
             emitToBuffer(constructMWCBDeclineLevelMsg(data), MWCBDeclineLevelMsgType);
         };
-        dispatchTable[MWCBStatusMsgType] = [](const char* data) {
+        table[MWCBStatusMsgType] = [](const char* data) {
             emitToBuffer(constructMWCBStatusMsg(data), MWCBStatusMsgType);
         };
-        dispatchTable[IPOQuotingPeriodUpdateMsgType] = [](const char* data) {
+        table[IPOQuotingPeriodUpdateMsgType] = [](const char* data) {
             emitToBuffer(constructIPOQuotingPeriodUpdateMsg(data), IPOQuotingPeriodUpdateMsgType);
         };
-        dispatchTable[LULDAuctionCollarMsgType] = [](const char* data) {
+        table[LULDAuctionCollarMsgType] = [](const char* data) {
             emitToBuffer(constructLULDAuctionCollarMsg(data), LULDAuctionCollarMsgType);
         };
-        dispatchTable[OperationalHaltMsgType] = [](const char* data) {
+        table[OperationalHaltMsgType] = [](const char* data) {
             emitToBuffer(constructOperationalHaltMsg(data), OperationalHaltMsgType);
         };
-        dispatchTable[AddOrderMsgType] = [](const char* data) {
+        table[AddOrderMsgType] = [](const char* data) {
             emitToBuffer(constructAddOrderMsg(data), AddOrderMsgType);
         };
-        dispatchTable[AddOrderMPIDAttributionMsgType] = [](const char* data) {
+        table[AddOrderMPIDAttributionMsgType] = [](const char* data) {
             emitToBuffer(constructAddOrderMPIDAttributionMsg(data), AddOrderMPIDAttributionMsgType);
         };
-        dispatchTable[OrderExecutedMsgType] = [](const char* data) {
+        table[OrderExecutedMsgType] = [](const char* data) {
             emitToBuffer(constructOrderExecutedMsg(data), OrderExecutedMsgType);
         };
-        dispatchTable[OrderExecutedWithPriceMsgType] = [](const char* data) {
+        table[OrderExecutedWithPriceMsgType] = [](const char* data) {
             emitToBuffer(constructOrderExecutedWithPriceMsg(data), OrderExecutedWithPriceMsgType);
         };
-        dispatchTable[OrderCancelMsgType] = [](const char* data) {
+        table[OrderCancelMsgType] = [](const char* data) {
             emitToBuffer(constructOrderCancelMsg(data), OrderCancelMsgType);
         };
-        dispatchTable[OrderDeleteMsgType] = [](const char* data) {
+        table[OrderDeleteMsgType] = [](const char* data) {
             emitToBuffer(constructOrderDeleteMsg(data), OrderDeleteMsgType);
         };
-        dispatchTable[OrderReplaceMsgType] = [](const char* data) {
+        table[OrderReplaceMsgType] = [](const char* data) {
             emitToBuffer(constructOrderReplaceMsg(data), OrderReplaceMsgType);
         };
-        dispatchTable[TradeMsgType] = [](const char* data) {
+        table[TradeMsgType] = [](const char* data) {
             emitToBuffer(constructTradeMsg(data), TradeMsgType);
         };
-        dispatchTable[CrossTradeMsgType] = [](const char* data) {
+        table[CrossTradeMsgType] = [](const char* data) {
             emitToBuffer(constructCrossTradeMsg(data), CrossTradeMsgType);
         };
-        dispatchTable[BrokenTradeMsgType] = [](const char* data) {
+        table[BrokenTradeMsgType] = [](const char* data) {
             emitToBuffer(constructBrokenTradeMsg(data), BrokenTradeMsgType);
         };
-        dispatchTable[NOIIMessageMsgType] = [](const char* data) {
+        table[NOIIMessageMsgType] = [](const char* data) {
             emitToBuffer(constructNOIIMsg(data), NOIIMessageMsgType);
         };
-        dispatchTable[RetailInterestMsgType] = [](const char* data) {
+        table[RetailInterestMsgType] = [](const char* data) {
             emitToBuffer(constructRetailInterestMsg(data), RetailInterestMsgType);
         };
-        dispatchTable[DirectListingWithCRPDMsgType] = [](const char* data) {
+        table[DirectListingWithCRPDMsgType] = [](const char* data) {
             emitToBuffer(constructDirectListingWithCRPDMsg(data), DirectListingWithCRPDMsgType);
         };   
     }
 
     template <typename MsgT>
     void MmapReader::emitToBuffer(const MsgT& msg, msg_type type) {
-        buffer_->Write(sizeof(MsgT), [&](uint8_t* data) {
+        auto write = [&](uint8_t* data) {
             static_assert(sizeof(MsgT) <= 64, "Message too large for Block buffer");
             std::memcpy(data, &msg, sizeof(MsgT));
-        });
+        };
+
+        publish(msg.securityNameIdx, sizeof(MsgT), write);
+    }
+
+    template <typename Fn>
+    void MmapReader::publish(uint16_t locate, PayloadSize size, Fn&& write) {
+        LATENCY_PROBE(LatencyProbe::decoded());
+
+        [[unlikely]] if (shards_) {
+            shards_->Stage(locate, size, write);
+        } else if (byteRing_) {
+            byteRing_->Stage(static_cast<uint16_t>(size), write);
+        } else {
+            [[maybe_unused]] const uint64_t seq = buffer_->Stage(size, write);
+            LATENCY_PROBE(LatencyProbe::staged(seq));
+        }
+
+        if (++staged_ >= publishBatch_) flushPublished();
+    }
+
+    void MmapReader::flushPublished() {
+        if (!staged_) return;
+        staged_ = 0;
+
+        [[unlikely]] if (shards_) {
+            shards_->Publish();
+            return;
+        }
+        if (byteRing_) {
+            byteRing_->Publish();
+            return;
+        }
+        buffer_->Publish();
+    }
+
+    void MmapReader::initDecodeTable() {
+        decodeTable[SystemEventMsgType]               = &decodeInto<constructSystemEventMsg, SystemEventMsgType>;
+        decodeTable[StockDirectoryMsgType]            = &decodeInto<constructStockDirectoryMsg, StockDirectoryMsgType>;
+        decodeTable[StockTradingActionMsgType]        = &decodeInto<constructStockTradingActionMsg, StockTradingActionMsgType>;
+        decodeTable[RegSHORestrictionMsgType]         = &decodeInto<constructRegSHORestrictionMsg, RegSHORestrictionMsgType>;
+        decodeTable[MarketParticipantPositionMsgType] = &decodeInto<constructMarketParticipantPositionMsg, MarketParticipantPositionMsgType>;
+        decodeTable[MWCBDeclineLevelMsgType]          = &decodeInto<constructMWCBDeclineLevelMsg, MWCBDeclineLevelMsgType>;
+        decodeTable[MWCBStatusMsgType]                = &decodeInto<constructMWCBStatusMsg, MWCBStatusMsgType>;
+        decodeTable[IPOQuotingPeriodUpdateMsgType]    = &decodeInto<constructIPOQuotingPeriodUpdateMsg, IPOQuotingPeriodUpdateMsgType>;
+        decodeTable[LULDAuctionCollarMsgType]         = &decodeInto<constructLULDAuctionCollarMsg, LULDAuctionCollarMsgType>;
+        decodeTable[OperationalHaltMsgType]           = &decodeInto<constructOperationalHaltMsg, OperationalHaltMsgType>;
+        decodeTable[AddOrderMsgType]                  = &decodeInto<constructAddOrderMsg, AddOrderMsgType>;
+        decodeTable[AddOrderMPIDAttributionMsgType]   = &decodeInto<constructAddOrderMPIDAttributionMsg, AddOrderMPIDAttributionMsgType>;
+        decodeTable[OrderExecutedMsgType]             = &decodeInto<constructOrderExecutedMsg, OrderExecutedMsgType>;
+        decodeTable[OrderExecutedWithPriceMsgType]    = &decodeInto<constructOrderExecutedWithPriceMsg, OrderExecutedWithPriceMsgType>;
+        decodeTable[OrderCancelMsgType]               = &decodeInto<constructOrderCancelMsg, OrderCancelMsgType>;
+        decodeTable[OrderDeleteMsgType]               = &decodeInto<constructOrderDeleteMsg, OrderDeleteMsgType>;
+        decodeTable[OrderReplaceMsgType]              = &decodeInto<constructOrderReplaceMsg, OrderReplaceMsgType>;
+        decodeTable[TradeMsgType]                     = &decodeInto<constructTradeMsg, TradeMsgType>;
+        decodeTable[CrossTradeMsgType]                = &decodeInto<constructCrossTradeMsg, CrossTradeMsgType>;
+        decodeTable[BrokenTradeMsgType]               = &decodeInto<constructBrokenTradeMsg, BrokenTradeMsgType>;
+        decodeTable[NOIIMessageMsgType]               = &decodeInto<constructNOIIMsg, NOIIMessageMsgType>;
+        decodeTable[RetailInterestMsgType]            = &decodeInto<constructRetailInterestMsg, RetailInterestMsgType>;
+        decodeTable[DirectListingWithCRPDMsgType]     = &decodeInto<constructDirectListingWithCRPDMsg, DirectListingWithCRPDMsgType>;
+    }
+
+    template <auto Construct, msg_type Type>
+    void MmapReader::decodeInto(const char* data, MsgEnvelope& env) {
+        env.setPayload(Construct(data), Type);
+    }
+
+    bool MmapReader::isFrameChain(const char* p, size_t frames) const {
+        for (size_t i = 0; i < frames && p < end; ++i) {
+            if (p + 3 > end) return false;
+
+            uint16_t msgLength = ntohs(*reinterpret_cast<const uint16_t*>(p));
+            uint16_t expected = MsgSizeTable[static_cast<uint8_t>(p[2])];
+
+            if (expected == 0 || msgLength != expected || p + 2 + msgLength > end) return false;
+            p += 2 + msgLength;
+        }
+        return true;
+    }
+
+    const char* MmapReader::findFrameBoundary(const char* from) const {
+        // Frames carry no sync marker, so accept the first offset that starts a chain of
+        // RESYNC_FRAMES frames whose length prefix matches the wire size of their type
+        for (const char* p = from; p < end; ++p) {
+            if (isFrameChain(p, RESYNC_FRAMES)) return p;
+        }
+        return end;
+    }
+
+    std::vector<ParseRange> MmapReader::splitRanges(size_t numRanges) const {
+        if (numRanges == 0) numRanges = 1;
+
+        const size_t total = end - start;
+        std::vector<const char*> bounds(numRanges + 1, end);
+        bounds[0] = start;
+
+        std::vector<ParseRange> ranges(numRanges);
+        std::vector<std::jthread> workers;
+        workers.reserve(numRanges);
+
+        // Pass 1: locate the first real frame at or after each nominal split point
+        for (size_t i = 1; i < numRanges; ++i) {
+            workers.emplace_back([&, i] {
+                bounds[i] = findFrameBoundary(start + total / numRanges * i);
+            });
+        }
+        workers.clear();
+
+        // Tiny ranges can resync past the next split point, keep the boundaries ordered
+        for (size_t i = 1; i <= numRanges; ++i) {
+            bounds[i] = std::max(bounds[i], bounds[i - 1]);
+        }
+
+        // Pass 2: hop the length prefixes of each range to count its frames
+        for (size_t i = 0; i < numRanges; ++i) {
+            workers.emplace_back([&, i] {
+                const char* p = bounds[i];
+                uint64_t count = 0;
+                while (p < bounds[i + 1] && p + 2 <= end) {
+                    uint16_t msgLength = ntohs(*reinterpret_cast<const uint16_t*>(p));
+                    if (p + 2 + msgLength > end) break;
+                    p += 2 + msgLength;
+                    ++count;
+                }
+                ranges[i] = {bounds[i], p, 0, count};
+            });
+        }
+        workers.clear();
+
+        uint64_t seq = 0;
+        for (size_t i = 0; i < numRanges; ++i) {
+            // The chain walked from the previous boundary has to land exactly on the next one
+            if (i + 1 < numRanges && ranges[i].end != bounds[i + 1]) {
+                throw std::runtime_error("Failed to resynchronise on a message boundary");
+            }
+            ranges[i].firstSeq = seq;
+            seq += ranges[i].count;
+        }
+        return ranges;
+    }
+
+    void MmapReader::parseParallel(size_t numThreads, const RangeSink& sink) const {
+        const std::vector<ParseRange> ranges = splitRanges(numThreads);
+
+        std::vector<std::jthread> workers;
+        workers.reserve(ranges.size());
+
+        for (size_t i = 0; i < ranges.size(); ++i) {
+            workers.emplace_back([&, i] {
+                const ParseRange& range = ranges[i];
+                MsgEnvelope env;
+                uint64_t seq = range.firstSeq;
+
+                for (const char* p = range.begin; p < range.end; ++seq) {
+                    uint16_t msgLength = ntohs(*reinterpret_cast<const uint16_t*>(p));
+                    const char* raw = p + 2;
+                    p += 2 + msgLength;
+
+                    auto handler = decodeTable[static_cast<uint8_t>(getDataMessageType(raw))];
+
+                    [[likely]] if (handler) {
+                        handler(raw, env);
+                        sink(i, seq, env);
+                    }
+                }
+            });
+        }
+    }
+
+    void MmapReader::emitRawBytes(const char* data) {
+        const uint16_t length = MsgSizeTable[static_cast<uint8_t>(data[0])];
+        auto write = [&](uint8_t* dst) {
+            std::memcpy(dst, data, length);
+        };
+
+        publish(readU16(data, 1), length, write);
+    }
+
+    void MmapReader::emitFrameRef(const char* data) {
+        const FrameRef ref{data, MsgSizeTable[static_cast<uint8_t>(data[0])], data[0]};
+        auto write = [&](uint8_t* dst) {
+            std::memcpy(dst, &ref, sizeof(FrameRef));
+        };
+
+        publish(readU16(data, 1), sizeof(FrameRef), write);
     }
 
     const char* MmapReader::nextMsg() {
@@ -180,6 +502,9 @@ namespace ITCH {
 
         const char* msgStart = cursor + 2;
         cursor += 2 + msgLength;
+        ++msgNumber;
+
+        LATENCY_PROBE(LatencyProbe::cursor());
         
         return msgStart;
     }
@@ -487,7 +812,7 @@ namespace ITCH {
         return m;
     }
 
-    ts MmapReader::getDataTimestamp(const char* d){
+    ts MmapReader::getDataTimestamp(const char* d) {
         return readU48(d,5);
     }
 
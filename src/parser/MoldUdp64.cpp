@@ -0,0 +1,497 @@
+#include "../../include/parser/MoldUdp64.hpp"
+#include "../../include/parser/ItchReaders.hpp"
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <linux/sock_diag.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace ITCH {
+
+    namespace {
+        constexpr uint32_t PCAP_MAGIC_US = 0xa1b2c3d4;
+        constexpr uint32_t PCAP_MAGIC_NS = 0xa1b23c4d;
+        constexpr size_t   PCAP_GLOBAL_HEADER = 24;
+        constexpr size_t   PCAP_RECORD_HEADER = 16;
+
+        constexpr uint32_t LINKTYPE_ETHERNET = 1;
+        constexpr uint32_t LINKTYPE_RAW = 101;
+        constexpr uint32_t LINKTYPE_LINUX_SLL = 113;
+
+        constexpr uint16_t ETHERTYPE_IPV4 = 0x0800;
+        constexpr uint16_t ETHERTYPE_VLAN = 0x8100;
+        constexpr uint8_t  IPPROTO_UDP_ = 17;
+
+        void writeBE16(char* p, uint16_t v) { v = htobe16(v); std::memcpy(p, &v, 2); }
+        void writeBE64(char* p, uint64_t v) { v = htobe64(v); std::memcpy(p, &v, 8); }
+
+        // Single writer, so a relaxed load and store instead of a locked add
+        void add(std::atomic<uint64_t>& counter, uint64_t n = 1) {
+            counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+    }
+
+    bool readMoldHeader(const char* data, size_t len, MoldHeader& header) {
+        if (len < MOLD_HEADER_SIZE) return false;
+        std::memcpy(header.session, data, MOLD_SESSION_SIZE);
+        header.sequence = readU64(data, 10);
+        header.count = readU16(data, 18);
+        return true;
+    }
+
+    MoldUdp64Session::MoldUdp64Session(PublishMode mode, const TypeMask& types) {
+        if (mode == PublishMode::Reference) {
+            throw std::invalid_argument("Reference publish mode cannot outlive a packet buffer");
+        }
+        table = MmapReader::makeDispatchTable(mode, types);
+    }
+
+    MoldSessionStats MoldUdp64Session::stats() const {
+        auto get = [](const std::atomic<uint64_t>& counter) { return counter.load(std::memory_order_relaxed); };
+        return {
+            .packets = get(counters.packets),
+            .messages = get(counters.messages),
+            .heartbeats = get(counters.heartbeats),
+            .duplicates = get(counters.duplicates),
+            .gaps = get(counters.gaps),
+            .missedMessages = get(counters.missedMessages),
+            .malformed = get(counters.malformed),
+            .endOfSession = counters.endOfSession.load(std::memory_order_relaxed),
+        };
+    }
+
+    bool MoldUdp64Session::onPacket(const char* data, size_t len) {
+        MoldHeader header;
+        if (!readMoldHeader(data, len, header)) {
+            add(counters.malformed);
+            return false;
+        }
+
+        add(counters.packets);
+        std::memcpy(sessionName, header.session, MOLD_SESSION_SIZE);
+
+        if (header.count == MOLD_END_OF_SESSION) {
+            counters.endOfSession.store(true, std::memory_order_relaxed);
+            return true;
+        }
+
+        if (nextSeq == 0) nextSeq = header.sequence;
+
+        // A heartbeat carries the next sequence number, so it reveals a gap just like data does
+        if (header.sequence > nextSeq) {
+            add(counters.gaps);
+            add(counters.missedMessages, header.sequence - nextSeq);
+            nextSeq = header.sequence;
+        }
+
+        if (header.count == 0) {
+            add(counters.heartbeats);
+            return true;
+        }
+
+        uint16_t consumed = deliver(data + MOLD_HEADER_SIZE, len - MOLD_HEADER_SIZE, header.sequence, header.count);
+        if (consumed != header.count) {
+            add(counters.malformed);
+            return false;
+        }
+        return true;
+    }
+
+    uint16_t MoldUdp64Session::deliver(const char* blocks, size_t len, uint64_t firstSeq, uint16_t count) {
+        const char* p = blocks;
+        const char* end = blocks + len;
+
+        if (nextSeq == 0) nextSeq = firstSeq;
+
+        uint16_t i = 0;
+        for (; i < count; ++i) {
+            if (p + 2 > end) break;
+            uint16_t msgLength = readU16(p, 0);
+            if (msgLength == 0 || p + 2 + msgLength > end) break;
+
+            const char* msg = p + 2;
+            p += 2 + msgLength;
+
+            const uint64_t seq = firstSeq + i;
+            if (seq < nextSeq) {
+                add(counters.duplicates);
+                continue;
+            }
+
+            auto& handler = table[static_cast<uint8_t>(msg[0])];
+
+            [[likely]] if (handler) {
+                handler(msg);
+            }
+            add(counters.messages);
+            nextSeq = seq + 1;
+        }
+        // A packet is the natural publish batch
+        MmapReader::flushPublished();
+        return i;
+    }
+
+    PcapReader::PcapReader(const char* filename, uint16_t udpPort)
+        : fd(open(filename, O_RDONLY)), start(nullptr), cursor(nullptr), end(nullptr),
+          port(udpPort), linkType(0), swapped(false) {
+
+        if (fd == -1) {
+            throw std::runtime_error("Failed to open pcap: " + std::string(filename));
+        }
+
+        struct stat sb;
+        if (fstat(fd, &sb) == -1) {
+            close(fd);
+            throw std::runtime_error("Failed to get pcap stats");
+        }
+
+        if (static_cast<size_t>(sb.st_size) < PCAP_GLOBAL_HEADER) {
+            close(fd);
+            throw std::runtime_error("Pcap too small: " + std::string(filename));
+        }
+
+        start = static_cast<char*>(mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0));
+        if (start == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Failed to mmap pcap");
+        }
+        end = start + sb.st_size;
+
+        uint32_t magic;
+        std::memcpy(&magic, start, 4);
+        if (magic == PCAP_MAGIC_US || magic == PCAP_MAGIC_NS) {
+            swapped = false;
+        } else if (__builtin_bswap32(magic) == PCAP_MAGIC_US || __builtin_bswap32(magic) == PCAP_MAGIC_NS) {
+            swapped = true;
+        } else {
+            munmap(start, end - start);
+            close(fd);
+            throw std::runtime_error("Not a pcap file: " + std::string(filename));
+        }
+
+        linkType = field32(start + 20) & 0xFFFF;
+        cursor = start + PCAP_GLOBAL_HEADER;
+    }
+
+    PcapReader::~PcapReader() {
+        if (start != MAP_FAILED && start != nullptr) {
+            munmap(start, end - start);
+        }
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+
+    uint32_t PcapReader::field32(const char* p) const {
+        uint32_t v;
+        std::memcpy(&v, p, 4);
+        return swapped ? __builtin_bswap32(v) : v;
+    }
+
+    bool PcapReader::udpPayload(const char* frame, size_t caplen, const char*& data, size_t& len) const {
+        const char* p = frame;
+        const char* stop = frame + caplen;
+
+        if (linkType == LINKTYPE_ETHERNET) {
+            if (p + 14 > stop) return false;
+            uint16_t etherType = readU16(p, 12);
+            p += 14;
+            while (etherType == ETHERTYPE_VLAN) {
+                if (p + 4 > stop) return false;
+                etherType = readU16(p, 2);
+                p += 4;
+            }
+            if (etherType != ETHERTYPE_IPV4) return false;
+        } else if (linkType == LINKTYPE_LINUX_SLL) {
+            if (p + 16 > stop || readU16(p, 14) != ETHERTYPE_IPV4) return false;
+            p += 16;
+        } else if (linkType != LINKTYPE_RAW) {
+            return false;
+        }
+
+        // IPv4, first fragments only
+        if (p + 20 > stop || (readU8(p, 0) >> 4) != 4) return false;
+        const size_t ihl = (readU8(p, 0) & 0x0F) * 4;
+        if (readU8(p, 9) != IPPROTO_UDP_ || (readU16(p, 6) & 0x1FFF) != 0) return false;
+        const char* ipEnd = std::min(stop, p + readU16(p, 2));
+        p += ihl;
+
+        if (p + 8 > ipEnd) return false;
+        if (port != 0 && readU16(p, 2) != port) return false;
+        const char* udpEnd = std::min(ipEnd, p + readU16(p, 4));
+
+        data = p + 8;
+        len = udpEnd > data ? udpEnd - data : 0;
+        return true;
+    }
+
+    bool PcapReader::nextPayload(const char*& data, size_t& len) {
+        while (cursor + PCAP_RECORD_HEADER <= end) {
+            const uint32_t caplen = field32(cursor + 8);
+            const char* frame = cursor + PCAP_RECORD_HEADER;
+            if (frame + caplen > end) return false;
+            cursor = const_cast<char*>(frame + caplen);
+
+            if (udpPayload(frame, caplen, data, len)) return true;
+        }
+        return false;
+    }
+
+    uint64_t PcapReader::run(MoldUdp64Session& session) {
+        uint64_t packets = 0;
+        const char* data;
+        size_t len;
+        while (nextPayload(data, len)) {
+            session.onPacket(data, len);
+            ++packets;
+        }
+        return packets;
+    }
+
+    UdpReader::UdpReader(uint16_t port, const char* group, const char* iface)
+        : fd(socket(AF_INET, SOCK_DGRAM, 0)), boundPort(0) {
+
+        if (fd == -1) {
+            throw std::runtime_error("Failed to create UDP socket");
+        }
+
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        int rcvbuf = 8 << 20;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = group ? htonl(INADDR_ANY) : inet_addr(iface);
+
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+            close(fd);
+            throw std::runtime_error("Failed to bind UDP port " + std::to_string(port));
+        }
+
+        if (group) {
+            ip_mreq mreq{};
+            mreq.imr_multiaddr.s_addr = inet_addr(group);
+            mreq.imr_interface.s_addr = inet_addr(iface);
+            if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) == -1) {
+                close(fd);
+                throw std::runtime_error("Failed to join multicast group " + std::string(group));
+            }
+        }
+
+        socklen_t addrLen = sizeof(addr);
+        getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &addrLen);
+        boundPort = ntohs(addr.sin_port);
+    }
+
+    UdpReader::~UdpReader() {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+
+    bool UdpReader::receive(const char*& data, size_t& len, int timeoutMs) {
+        pollfd pfd{fd, POLLIN, 0};
+        if (::poll(&pfd, 1, timeoutMs) <= 0) return false;
+
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) return false;
+
+        data = buffer;
+        len = static_cast<size_t>(n);
+        return true;
+    }
+
+    bool UdpReader::poll(MoldUdp64Session& session, int timeoutMs) {
+        const char* data;
+        size_t len;
+        if (!receive(data, len, timeoutMs)) return false;
+
+        session.onPacket(data, len);
+        return true;
+    }
+
+    void UdpReader::run(MoldUdp64Session& session, const std::atomic<bool>& running) {
+        while (running.load(std::memory_order_relaxed) && !session.endOfSession()) {
+            poll(session, 10);
+        }
+    }
+
+    MoldPacketBuilder::MoldPacketBuilder(std::string_view session) : length(MOLD_HEADER_SIZE), messages(0), firstSeq(1) {
+        std::memset(packet, ' ', MOLD_SESSION_SIZE);
+        std::memcpy(packet, session.data(), std::min(session.size(), MOLD_SESSION_SIZE));
+        writeHeader();
+    }
+
+    void MoldPacketBuilder::reset(uint64_t seq) {
+        firstSeq = seq;
+        messages = 0;
+        length = MOLD_HEADER_SIZE;
+        writeHeader();
+    }
+
+    bool MoldPacketBuilder::add(const char* msg, uint16_t len) {
+        if (length + 2 + len > sizeof(packet)) return false;
+        writeBE16(packet + length, len);
+        std::memcpy(packet + length + 2, msg, len);
+        length += 2 + len;
+        ++messages;
+        writeHeader();
+        return true;
+    }
+
+    void MoldPacketBuilder::control(uint64_t seq, uint16_t count) {
+        reset(seq);
+        writeBE16(packet + 18, count);
+    }
+
+    void MoldPacketBuilder::writeHeader() {
+        writeBE64(packet + 10, firstSeq);
+        writeBE16(packet + 18, messages);
+    }
+
+    LoopbackSender::LoopbackSender(uint16_t port, const char* host, std::string_view session)
+        : fd(socket(AF_INET, SOCK_DGRAM, 0)), builder(session) {
+
+        if (fd == -1) {
+            throw std::runtime_error("Failed to create UDP socket");
+        }
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = inet_addr(host);
+
+        // Connected UDP socket so every send goes to the same receiver
+        if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+            close(fd);
+            throw std::runtime_error("Failed to connect UDP socket to " + std::string(host));
+        }
+    }
+
+    LoopbackSender::~LoopbackSender() {
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+
+    void LoopbackSender::sendPacket(const char* data, size_t len) {
+        if (throttleFd != -1) {
+            uint32_t memory[SK_MEMINFO_VARS];
+            socklen_t size = sizeof(memory);
+            while (getsockopt(throttleFd, SOL_SOCKET, SO_MEMINFO, memory, &size) == 0 &&
+                   memory[SK_MEMINFO_RMEM_ALLOC] > memory[SK_MEMINFO_RCVBUF] / 2) {
+                std::this_thread::yield();
+            }
+        }
+        if (send(fd, data, len, 0) == -1) {
+            throw std::runtime_error("Failed to send UDP packet");
+        }
+    }
+
+    uint64_t LoopbackSender::sendFile(const char* itchFile, uint64_t maxMessages, std::chrono::nanoseconds interPacketGap,
+                                      uint64_t dropEvery) {
+        MmapReader reader(itchFile);
+        builder.reset(1);
+
+        uint64_t packets = 0;
+        auto flush = [&] {
+            ++packets;
+            if (dropEvery == 0 || packets % dropEvery != 0) sendPacket(builder.data(), builder.size());
+            builder.reset(builder.nextSequence());
+            if (interPacketGap.count() > 0) std::this_thread::sleep_for(interPacketGap);
+        };
+
+        uint64_t sent = 0;
+        while (sent < maxMessages) {
+            const char* raw = reader.nextMsg();
+            if (!raw) break;
+
+            uint16_t msgLength = readU16(raw - 2, 0);
+            if (!builder.add(raw, msgLength)) {
+                flush();
+                builder.add(raw, msgLength);
+            }
+            ++sent;
+        }
+        if (builder.count()) flush();
+        return sent;
+    }
+
+    void LoopbackSender::sendEndOfSession(uint64_t nextSeq) {
+        builder.control(nextSeq, MOLD_END_OF_SESSION);
+        sendPacket(builder.data(), builder.size());
+        builder.reset(nextSeq);
+    }
+
+    uint64_t writeMoldPcap(const char* itchFile, const char* pcapFile, uint16_t port,
+                           uint64_t maxMessages, std::string_view session) {
+        std::ofstream out(pcapFile, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Failed to create pcap: " + std::string(pcapFile));
+        }
+
+        // Native byte order global header, microsecond timestamps, Ethernet link type
+        uint32_t global[6] = {PCAP_MAGIC_US, 0x00040002, 0, 0, 65535, LINKTYPE_ETHERNET};
+        out.write(reinterpret_cast<const char*>(global), sizeof(global));
+
+        MmapReader reader(itchFile);
+        MoldPacketBuilder builder(session);
+        builder.reset(1);
+
+        auto writePacket = [&] {
+            char frame[14 + 20 + 8];
+            std::memset(frame, 0, sizeof(frame));
+            writeBE16(frame + 12, ETHERTYPE_IPV4);
+
+            char* ip = frame + 14;
+            ip[0] = 0x45;
+            writeBE16(ip + 2, static_cast<uint16_t>(20 + 8 + builder.size()));
+            ip[8] = 64;
+            ip[9] = IPPROTO_UDP_;
+
+            char* udp = ip + 20;
+            writeBE16(udp + 0, port);
+            writeBE16(udp + 2, port);
+            writeBE16(udp + 4, static_cast<uint16_t>(8 + builder.size()));
+
+            uint32_t record[4] = {0, 0, static_cast<uint32_t>(sizeof(frame) + builder.size()),
+                                  static_cast<uint32_t>(sizeof(frame) + builder.size())};
+            out.write(reinterpret_cast<const char*>(record), sizeof(record));
+            out.write(frame, sizeof(frame));
+            out.write(builder.data(), builder.size());
+            builder.reset(builder.nextSequence());
+        };
+
+        uint64_t written = 0;
+        while (written < maxMessages) {
+            const char* raw = reader.nextMsg();
+            if (!raw) break;
+
+            uint16_t msgLength = readU16(raw - 2, 0);
+            if (!builder.add(raw, msgLength)) {
+                writePacket();
+                builder.add(raw, msgLength);
+            }
+            ++written;
+        }
+        if (builder.count()) writePacket();
+
+        if (!out) {
+            throw std::runtime_error("Failed to write pcap: " + std::string(pcapFile));
+        }
+        return written;
+    }
+
+}
@@ -0,0 +1,319 @@
+#include "../../include/parser/StreamReader.hpp"
+#include "../../include/parser/ItchReaders.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifdef EXCELSIOR_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace ITCH {
+
+    namespace {
+        constexpr size_t INPUT_CHUNK = 1 << 20;
+        constexpr size_t NO_BUFFER = SIZE_MAX;
+        constexpr size_t MAX_FRAME = 2 + UINT16_MAX;
+    }
+
+    StreamReader::StreamReader(const char* filename, PublishMode mode, const TypeMask& types,
+                               size_t bufferSize, size_t bufferCount)
+        : fd(open(filename, O_RDONLY)), format(Compression::None), bufferSize(bufferSize) {
+
+        if (fd == -1) {
+            throw std::runtime_error("Failed to open file: " + std::string(filename));
+        }
+        if (mode == PublishMode::Reference) {
+            close(fd);
+            throw std::invalid_argument("Reference publish mode cannot outlive a stream buffer");
+        }
+        if (bufferSize < MAX_FRAME || bufferCount < 2) {
+            close(fd);
+            throw std::invalid_argument("Need at least two buffers of at least one maximum size frame");
+        }
+
+        unsigned char magic[4] = {};
+        if (pread(fd, magic, sizeof(magic), 0) == static_cast<ssize_t>(sizeof(magic))) {
+            if (magic[0] == 0x1f && magic[1] == 0x8b) {
+                format = Compression::Gzip;
+            } else if (magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+                format = Compression::Zstd;
+            }
+        }
+
+        if (format == Compression::Gzip) {
+            z_stream* zs = new z_stream{};
+            // 16 + MAX_WBITS: expect a gzip header rather than a raw zlib stream
+            if (inflateInit2(zs, 16 + MAX_WBITS) != Z_OK) {
+                delete zs;
+                close(fd);
+                throw std::runtime_error("Failed to initialise gzip decoder");
+            }
+            codec = zs;
+        } else if (format == Compression::Zstd) {
+#ifdef EXCELSIOR_WITH_ZSTD
+            ZSTD_DStream* zs = ZSTD_createDStream();
+            if (!zs || ZSTD_isError(ZSTD_initDStream(zs))) {
+                ZSTD_freeDStream(zs);
+                close(fd);
+                throw std::runtime_error("Failed to initialise zstd decoder");
+            }
+            codec = zs;
+#else
+            close(fd);
+            throw std::runtime_error("Built without zstd support, rebuild with make ZSTD=1");
+#endif
+        }
+
+        input = std::make_unique<char[]>(INPUT_CHUNK);
+        buffers.resize(bufferCount);
+        for (size_t i = 0; i < bufferCount; ++i) {
+            buffers[i].data = std::make_unique<char[]>(bufferSize);
+            freeBuffers.push_back(i);
+        }
+        carry.reserve(MAX_FRAME);
+        table = MmapReader::makeDispatchTable(mode, types);
+    }
+
+    StreamReader::~StreamReader() {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        if (producer.joinable()) producer.join();
+
+        if (format == Compression::Gzip && codec) {
+            inflateEnd(static_cast<z_stream*>(codec));
+            delete static_cast<z_stream*>(codec);
+        }
+#ifdef EXCELSIOR_WITH_ZSTD
+        if (format == Compression::Zstd && codec) {
+            ZSTD_freeDStream(static_cast<ZSTD_DStream*>(codec));
+        }
+#endif
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+
+    void StreamReader::parse() {
+        producer = std::thread(&StreamReader::decompressLoop, this);
+
+        while (true) {
+            size_t index;
+            {
+                std::unique_lock lock(mutex);
+                if (readyBuffers.empty() && !producerDone) ++counters.parserStalls;
+                cv.wait(lock, [&] { return !readyBuffers.empty() || producerDone; });
+                if (readyBuffers.empty()) break;
+                index = readyBuffers.front();
+                readyBuffers.pop_front();
+            }
+
+            const Buffer& buffer = buffers[index];
+            const char* p = buffer.data.get();
+            const char* end = p + buffer.size;
+
+            p = consumeCarry(p, end);
+            p = parseFrames(p, end);
+            carry.insert(carry.end(), p, end);
+            MmapReader::flushPublished();
+
+            {
+                std::lock_guard lock(mutex);
+                freeBuffers.push_back(index);
+            }
+            cv.notify_all();
+        }
+
+        producer.join();
+        if (producerError) std::rethrow_exception(producerError);
+        if (!carry.empty()) {
+            throw std::runtime_error("Input ends inside a frame, " + std::to_string(carry.size()) + " bytes left over");
+        }
+    }
+
+    const char* StreamReader::consumeCarry(const char* p, const char* end) {
+        if (carry.empty()) return p;
+
+        while (carry.size() < 2 && p < end) carry.push_back(*p++);
+        if (carry.size() < 2) return p;
+
+        const size_t need = 2 + readU16(carry.data(), 0) - carry.size();
+        const size_t take = std::min<size_t>(need, end - p);
+        carry.insert(carry.end(), p, p + take);
+        p += take;
+
+        if (take == need) {
+            if (carry.size() > 2) dispatch(carry.data() + 2);
+            ++counters.straddledFrames;
+            carry.clear();
+        }
+        return p;
+    }
+
+    const char* StreamReader::parseFrames(const char* p, const char* end) {
+        while (p + 2 <= end) {
+            const uint16_t msgLength = readU16(p, 0);
+            if (p + 2 + msgLength > end) break;
+
+            if (msgLength) dispatch(p + 2);
+            p += 2 + msgLength;
+        }
+        return p;
+    }
+
+    void StreamReader::dispatch(const char* msg) {
+        auto& handler = table[static_cast<uint8_t>(msg[0])];
+
+        [[likely]] if (handler) {
+            handler(msg);
+        }
+        ++counters.messages;
+    }
+
+    size_t StreamReader::acquireFree() {
+        std::unique_lock lock(mutex);
+        cv.wait(lock, [&] { return !freeBuffers.empty() || stopping; });
+        if (stopping) return NO_BUFFER;
+
+        size_t index = freeBuffers.front();
+        freeBuffers.pop_front();
+        return index;
+    }
+
+    void StreamReader::publishReady(size_t index) {
+        {
+            std::lock_guard lock(mutex);
+            readyBuffers.push_back(index);
+        }
+        cv.notify_all();
+    }
+
+    void StreamReader::decompressLoop() {
+        try {
+            while (true) {
+                size_t index = acquireFree();
+                if (index == NO_BUFFER) break;
+
+                Buffer& buffer = buffers[index];
+                size_t filled = 0;
+                while (filled < bufferSize) {
+                    size_t got = 0;
+                    switch (format) {
+                        case Compression::None: got = fillPlain(buffer.data.get() + filled, bufferSize - filled); break;
+                        case Compression::Gzip: got = fillGzip(buffer.data.get() + filled, bufferSize - filled); break;
+                        case Compression::Zstd: got = fillZstd(buffer.data.get() + filled, bufferSize - filled); break;
+                    }
+                    if (got == 0) break;
+                    filled += got;
+                }
+
+                buffer.size = filled;
+                counters.decompressedBytes += filled;
+
+                if (filled == 0) {
+                    std::lock_guard lock(mutex);
+                    freeBuffers.push_back(index);
+                    break;
+                }
+
+                ++counters.buffersFilled;
+                publishReady(index);
+                if (filled < bufferSize) break;
+            }
+        } catch (...) {
+            producerError = std::current_exception();
+        }
+
+        {
+            std::lock_guard lock(mutex);
+            producerDone = true;
+        }
+        cv.notify_all();
+    }
+
+    bool StreamReader::refillInput() {
+        if (inputEof) return false;
+
+        ssize_t n = read(fd, input.get(), INPUT_CHUNK);
+        if (n < 0) throw std::runtime_error("Failed to read compressed input");
+        if (n == 0) {
+            inputEof = true;
+            return false;
+        }
+
+        inputSize = static_cast<size_t>(n);
+        inputPos = 0;
+        counters.compressedBytes += inputSize;
+        return true;
+    }
+
+    size_t StreamReader::fillPlain(char* dst, size_t capacity) {
+        ssize_t n = read(fd, dst, capacity);
+        if (n < 0) throw std::runtime_error("Failed to read input");
+        counters.compressedBytes += n;
+        return static_cast<size_t>(n);
+    }
+
+    size_t StreamReader::fillGzip(char* dst, size_t capacity) {
+        z_stream* zs = static_cast<z_stream*>(codec);
+        zs->next_out = reinterpret_cast<Bytef*>(dst);
+        zs->avail_out = static_cast<uInt>(std::min<size_t>(capacity, UINT32_MAX));
+        const uInt startOut = zs->avail_out;
+
+        while (zs->avail_out > 0) {
+            if (zs->avail_in == 0) {
+                if (!refillInput()) {
+                    if (zs->total_in != 0) throw std::runtime_error("Truncated gzip stream");
+                    break;
+                }
+                zs->next_in = reinterpret_cast<Bytef*>(input.get());
+                zs->avail_in = static_cast<uInt>(inputSize);
+            }
+
+            int rc = inflate(zs, Z_NO_FLUSH);
+            if (rc == Z_STREAM_END) {
+                // Files can be several gzip members back to back
+                inflateReset(zs);
+            } else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+                throw std::runtime_error(std::string("gzip: ") + (zs->msg ? zs->msg : "inflate failed"));
+            }
+        }
+        return startOut - zs->avail_out;
+    }
+
+    size_t StreamReader::fillZstd(char* dst, size_t capacity) {
+#ifdef EXCELSIOR_WITH_ZSTD
+        ZSTD_DStream* zs = static_cast<ZSTD_DStream*>(codec);
+        ZSTD_outBuffer out{dst, capacity, 0};
+
+        while (out.pos < out.size) {
+            if (inputPos == inputSize && !refillInput()) {
+                // Non-zero means the last frame still wanted input
+                if (zstdPending != 0) throw std::runtime_error("Truncated zstd stream");
+                break;
+            }
+
+            ZSTD_inBuffer in{input.get(), inputSize, inputPos};
+            size_t rc = ZSTD_decompressStream(zs, &out, &in);
+            inputPos = in.pos;
+            if (ZSTD_isError(rc)) {
+                throw std::runtime_error(std::string("zstd: ") + ZSTD_getErrorName(rc));
+            }
+            zstdPending = rc;
+        }
+        return out.pos;
+#else
+        (void)dst;
+        (void)capacity;
+        return 0;
+#endif
+    }
+
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include "SpmcRingBuffer.cpp"
+
+// Variable length broadcast ring. Messages are packed back to back as a 2-byte length followed by
+// the message bytes, so a 19 byte OrderDelete takes 21 bytes instead of a 128 byte Block. A frame
+// never wraps: when it does not fit before the end of the buffer the producer writes a length 0
+// padding marker (or leaves a lone byte) and the frame starts again at offset 0.
+//
+// Positions are byte offsets that only ever grow. Readers copy a frame out and then check the
+// producer's reservation to see whether it was overwritten underneath them, like a seqlock.
+class ByteRing {
+public:
+    static constexpr size_t FRAME_HEADER = sizeof(uint16_t);
+    // The reservation readers check is published this far ahead in one store, so the producer
+    // only touches that cache line about once per RESERVE_AHEAD bytes
+    static constexpr uint64_t RESERVE_AHEAD = 4096;
+    static constexpr size_t MIN_CAPACITY = 1 << 17;
+
+    explicit ByteRing(size_t capacity)
+        : capacity_(capacity), mask_(capacity - 1), data_(std::make_unique<uint8_t[]>(capacity)) {
+        // Room for the largest frame plus the reservation slack, or up to date readers look lapped
+        if (capacity < MIN_CAPACITY || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument("ByteRing capacity must be a power of two of at least 128KB");
+        }
+    }
+
+    ByteRing(const ByteRing& other) = delete;
+    ByteRing& operator=(const ByteRing& other) = delete;
+
+    // Producer only: publish one message of length bytes, write fills them
+    template <typename Fn>
+    void Write(uint16_t length, Fn&& write) {
+        Stage(length, std::forward<Fn>(write));
+        Publish();
+    }
+
+    // Producer only: append a frame without publishing it, see Publish
+    template <typename Fn>
+    void Stage(uint16_t length, Fn&& write) {
+        // Length 0 marks padding
+        [[unlikely]] if (length == 0) {
+            throw std::invalid_argument("ByteRing messages cannot be empty");
+        }
+
+        uint64_t pos = written_;
+        size_t offset = pos & mask_;
+        const size_t room = capacity_ - offset;
+        const size_t frame = FRAME_HEADER + length;
+        const bool wraps = room < frame;
+        if (wraps) pos += room;
+
+        // Move the reservation before touching any byte a reader might still be copying
+        [[unlikely]] if (pos + frame > reserved_) {
+            reserved_ = pos + frame + RESERVE_AHEAD;
+            header_.reserve.store(reserved_, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        if (wraps) {
+            if (room >= FRAME_HEADER) writeLength(offset, 0);
+            offset = 0;
+        }
+        writeLength(offset, length);
+        write(data_.get() + offset + FRAME_HEADER);
+        written_ = pos + frame;
+    }
+
+    // Producer only: make every staged frame visible
+    void Publish() {
+        header_.head.store(written_, std::memory_order_release);
+    }
+
+    // End of the last published frame
+    uint64_t head() const {
+        return header_.head.load(std::memory_order_acquire);
+    }
+
+    // Anything below reserve() - capacity() may have been overwritten
+    uint64_t reserve() const {
+        return header_.reserve.load(std::memory_order_relaxed);
+    }
+
+    size_t capacity() const {
+        return capacity_;
+    }
+
+    const uint8_t* data() const {
+        return data_.get();
+    }
+
+private:
+    struct Header {
+        alignas(64) std::atomic<uint64_t> head {0};
+        alignas(64) std::atomic<uint64_t> reserve {0};
+    };
+
+    Header header_;
+    size_t capacity_;
+    size_t mask_;
+    std::unique_ptr<uint8_t[]> data_;
+    // Producer only
+    uint64_t written_ = 0;
+    uint64_t reserved_ = 0;
+
+    void writeLength(size_t offset, uint16_t length) {
+        std::memcpy(data_.get() + offset, &length, sizeof(length));
+    }
+};
+
+// One consumer's position in a ByteRing. A lapped reader cannot find a frame boundary in the
+// middle of overwritten data, so it resumes at the producer's head and counts the bytes it lost.
+class ByteRingReader {
+public:
+    // fromHead joins at the producer's current position instead of byte 0
+    explicit ByteRingReader(const ByteRing& ring, bool fromHead = false)
+        : ring_(ring), data_(ring.data()), capacity_(ring.capacity()),
+          pos_(fromHead ? ring.head() : 0), knownHead_(pos_) {}
+
+    // Copy the next message into out (at least 65535 bytes, or the largest message published)
+    ReadStatus Read(uint8_t* out, size_t outSize, uint16_t& length) {
+        if (pos_ >= knownHead_) {
+            knownHead_ = ring_.head();
+            if (pos_ >= knownHead_) return ReadStatus::NotReady;
+        }
+
+        uint64_t frame = pos_;
+        size_t offset = frame & (capacity_ - 1);
+        size_t room = capacity_ - offset;
+
+        uint16_t len = 0;
+        if (room >= ByteRing::FRAME_HEADER) std::memcpy(&len, data_ + offset, sizeof(len));
+        // Padding up to the end of the buffer, the frame itself starts at offset 0
+        [[unlikely]] if (room < ByteRing::FRAME_HEADER || len == 0) {
+            frame += room;
+            offset = 0;
+            room = capacity_;
+            std::memcpy(&len, data_, sizeof(len));
+        }
+
+        // A torn length only comes with an overrun, clamp so the copy stays in bounds
+        std::memcpy(out, data_ + offset + ByteRing::FRAME_HEADER,
+                    std::min<size_t>(std::min<size_t>(len, outSize), room - ByteRing::FRAME_HEADER));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        [[unlikely]] if (ring_.reserve() > pos_ + capacity_) {
+            const uint64_t resume = ring_.head();
+            lastLap_ = resume - pos_;
+            lappedBytes_ += lastLap_;
+            ++overruns_;
+            pos_ = knownHead_ = resume;
+            return ReadStatus::Overrun;
+        }
+
+        if (len > outSize) {
+            throw std::length_error("ByteRing message larger than the read buffer");
+        }
+        length = len;
+        pos_ = frame + ByteRing::FRAME_HEADER + len;
+        return ReadStatus::Ok;
+    }
+
+    uint64_t position() const { return pos_; }
+
+    // Bytes lost to overruns, in total and in the most recent one
+    uint64_t lappedBytes() const { return lappedBytes_; }
+    uint64_t lastLap() const { return lastLap_; }
+    uint64_t overruns() const { return overruns_; }
+
+private:
+    const ByteRing& ring_;
+    const uint8_t* data_;
+    size_t capacity_;
+    uint64_t pos_;
+    uint64_t knownHead_;
+    uint64_t lappedBytes_ = 0;
+    uint64_t lastLap_ = 0;
+    uint64_t overruns_ = 0;
+};
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include "SpmcRingBuffer.cpp"
+
+// Work sharing on top of the broadcast queue: the members of a group split the stream between
+// them instead of each seeing every message. A member claims the next batch with one CAS on the
+// group's claim sequence. Plain SPMC_Readers on the same queue are unaffected.
+//
+// Each member holds a ConsumerSlot in the queue whose sequence is the start of the batch it is
+// working on, so a Lossless producer is gated on the group like on any reader. The group's
+// completion sequence (everything below it has been handled by some member) is the minimum of
+// those and the claim sequence, and a later stage can wait on it as a SequenceBarrier.
+class ConsumerGroup : public SequenceBarrier {
+public:
+    static constexpr size_t DEFAULT_MAX_MEMBERS = 16;
+
+    // fromHead starts the group at the producer's current position instead of sequence 0
+    explicit ConsumerGroup(SPMC_Queue& queue, bool fromHead = false, size_t maxMembers = DEFAULT_MAX_MEMBERS)
+        : queue_(queue), maxMembers_(maxMembers), members_(std::make_unique<std::atomic<ConsumerSlot*>[]>(maxMembers)) {
+        claim_.store(fromHead ? queue.head() : 0, std::memory_order_relaxed);
+        for (size_t i = 0; i < maxMembers_; ++i) members_[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    ConsumerGroup(const ConsumerGroup& other) = delete;
+    ConsumerGroup& operator=(const ConsumerGroup& other) = delete;
+
+    // Every sequence below this has been handled by the group
+    uint64_t completed() const {
+        // Claim first: a member stores its working sequence before the CAS that moves the claim
+        uint64_t done = claim_.load(std::memory_order_acquire);
+        for (size_t i = 0; i < maxMembers_; ++i) {
+            const ConsumerSlot* slot = members_[i].load(std::memory_order_acquire);
+            if (slot) done = std::min(done, slot->seq.load(std::memory_order_acquire));
+        }
+        return done;
+    }
+
+    uint64_t available() const override {
+        return completed();
+    }
+
+    // Next sequence no member has claimed yet
+    uint64_t claimed() const {
+        return claim_.load(std::memory_order_acquire);
+    }
+
+    SPMC_Queue& queue() const {
+        return queue_;
+    }
+
+private:
+    friend class GroupMember;
+
+    SPMC_Queue& queue_;
+    alignas(64) std::atomic<uint64_t> claim_;
+    size_t maxMembers_;
+    std::unique_ptr<std::atomic<ConsumerSlot*>[]> members_;
+
+    ConsumerSlot* join() {
+        ConsumerSlot* slot = queue_.registerConsumer(claim_.load(std::memory_order_acquire));
+        for (size_t i = 0; i < maxMembers_; ++i) {
+            ConsumerSlot* expected = nullptr;
+            if (members_[i].compare_exchange_strong(expected, slot, std::memory_order_acq_rel)) return slot;
+        }
+        queue_.unregisterConsumer(slot);
+        throw std::runtime_error("ConsumerGroup is full");
+    }
+
+    void leave(ConsumerSlot* slot) {
+        for (size_t i = 0; i < maxMembers_; ++i) {
+            ConsumerSlot* expected = slot;
+            if (members_[i].compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel)) break;
+        }
+        queue_.unregisterConsumer(slot);
+    }
+};
+
+// One worker of a ConsumerGroup. Each Next() call finishes the previous batch and claims the next.
+class GroupMember {
+public:
+    static constexpr size_t DEFAULT_BATCH = 64;
+
+    explicit GroupMember(ConsumerGroup& group, size_t batch = DEFAULT_BATCH)
+        : group_(group), queue_(group.queue()), batch_(batch ? batch : 1), slot_(group.join()) {}
+
+    GroupMember(const GroupMember& other) = delete;
+    GroupMember& operator=(const GroupMember& other) = delete;
+
+    ~GroupMember() {
+        group_.leave(slot_);
+    }
+
+    // Claim up to min(out.size(), batch) published messages nobody else in the group gets and copy
+    // them into out, sequences batchStart() onwards. Empty when nothing is ready.
+    std::span<QueueMessage> Next(std::span<QueueMessage> out) {
+        const size_t limit = std::min(out.size(), batch_);
+        uint64_t start = group_.claim_.load(std::memory_order_acquire);
+        uint64_t from, end;
+
+        while (true) {
+            // Never above anything this member goes on to claim, so completion stays a lower bound
+            slot_->seq.store(start, std::memory_order_release);
+
+            const uint64_t head = queue_.head();
+            if (start >= head || limit == 0) return out.first(0);
+
+            // A lapped group skips what the producer has already overwritten
+            const uint64_t oldest = queue_.oldest();
+            from = start < oldest ? oldest + 1 : start;
+            end = std::min<uint64_t>(from + limit, head);
+            if (group_.claim_.compare_exchange_weak(start, end, std::memory_order_acq_rel, std::memory_order_acquire)) break;
+        }
+        lost_ += from - start;
+        start_ = from;
+
+        size_t n = 0;
+        for (uint64_t seq = from; seq < end; ++seq) {
+            if (queue_.Read(seq, out[n].payload, out[n].size) == ReadStatus::Ok) {
+                ++n;
+            } else {
+                // Overwritten between the claim and the copy
+                ++lost_;
+            }
+        }
+        ++batches_;
+        return out.first(n);
+    }
+
+    // Spin, then yield, until the group has something left to claim
+    void Wait() {
+        for (uint32_t spins = 0; group_.claimed() >= queue_.head(); ++spins) {
+            if (spins < SPMC_Reader::SPIN_LIMIT) {
+                _mm_pause();
+            } else {
+                std::this_thread::yield();
+                return;
+            }
+        }
+    }
+
+    // First sequence of the batch returned by the last Next()
+    uint64_t batchStart() const { return start_; }
+
+    uint64_t batches() const { return batches_; }
+    uint64_t lost() const { return lost_; }
+
+private:
+    ConsumerGroup& group_;
+    SPMC_Queue& queue_;
+    size_t batch_;
+    ConsumerSlot* slot_;
+    uint64_t start_ = 0;
+    uint64_t batches_ = 0;
+    uint64_t lost_ = 0;
+};
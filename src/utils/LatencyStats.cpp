@@ -0,0 +1,306 @@
+#pragma once
+
+// Stage by stage latency from the parser's mmap cursor to a consumer finishing with a message.
+// Compiled in with EXCELSIOR_LATENCY (make LATENCY=1). Without it every LATENCY_PROBE expands
+// to nothing and the hot path is exactly the uninstrumented one.
+#ifndef EXCELSIOR_LATENCY
+#define LATENCY_PROBE(...)
+#else
+#define LATENCY_PROBE(...) __VA_ARGS__
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "TscClock.cpp"
+
+enum class LatencyStage : uint8_t {
+    Decode,     // nextMsg returned the frame -> message constructed
+    Publish,    // constructed -> staged in the queue
+    Queue,      // staged -> read by the consumer, includes time held back by a publish batch
+    Handle,     // read -> consumer done with it
+    Total,      // nextMsg -> consumer done
+    Count
+};
+
+inline const char* latencyStageName(LatencyStage stage) {
+    static constexpr const char* names[] = {"decode", "publish", "queue", "handle", "total"};
+    return names[static_cast<size_t>(stage)];
+}
+
+// Log-linear histogram of TSC ticks in the spirit of HdrHistogram: exact below 32, then 32
+// sub-buckets per power of two (about 3% resolution). Single writer, any number of readers.
+class LatencyHistogram {
+public:
+    static constexpr uint32_t SUB_BITS = 5;
+    static constexpr uint32_t SUB_BUCKETS = 1u << SUB_BITS;
+    static constexpr uint32_t MAX_BITS = 36;    // ~20s at 3GHz, larger values land in the top bucket
+    static constexpr size_t BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+    void record(uint64_t ticks) {
+        const size_t i = bucketOf(ticks);
+        // Only the owning consumer writes, relaxed load + store is enough and avoids a locked add
+        buckets_[i].store(buckets_[i].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (ticks > max_.load(std::memory_order_relaxed)) max_.store(ticks, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+    // Highest value equivalent to the bucket holding the q-th quantile, in ticks. Reads racing
+    // with record() see a few counts from either side, which only shifts the result by a bucket.
+    uint64_t percentile(double q) const {
+        const uint64_t total = count();
+        if (!total) return 0;
+
+        const uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += buckets_[i].load(std::memory_order_relaxed);
+            if (seen >= rank) return std::min(upperBound(i), max());
+        }
+        return max();
+    }
+
+    static size_t bucketOf(uint64_t ticks) {
+        if (ticks >= (uint64_t(1) << MAX_BITS)) return BUCKETS - 1;
+        if (ticks < SUB_BUCKETS) return ticks;
+
+        const uint32_t msb = 63 - std::countl_zero(ticks);
+        const uint64_t sub = (ticks >> (msb - SUB_BITS)) & (SUB_BUCKETS - 1);
+        return (msb - SUB_BITS + 1) * SUB_BUCKETS + sub;
+    }
+
+    static uint64_t upperBound(size_t bucket) {
+        if (bucket < SUB_BUCKETS) return bucket;
+
+        const uint32_t shift = static_cast<uint32_t>(bucket / SUB_BUCKETS) - 1;
+        const uint64_t sub = bucket % SUB_BUCKETS;
+        return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// Producer timestamps for one message
+struct LatencyStamps {
+    uint64_t cursor = 0;
+    uint64_t decoded = 0;
+    uint64_t staged = 0;
+};
+
+// Side channel next to an SPMC_Queue: the stamps of sequence seq live in slot seq & mask, so the
+// message payload is untouched. Same odd/even versioning as the queue, a lapped slot reads as missing.
+class LatencyChannel {
+public:
+    explicit LatencyChannel(size_t size) : mask_(size - 1), slots_(size) {
+        if (!std::has_single_bit(size)) {
+            throw std::invalid_argument("LatencyChannel size must be a power of two");
+        }
+    }
+
+    void put(uint64_t seq, const LatencyStamps& stamps) {
+        Slot& slot = slots_[seq & mask_];
+        slot.version.store(2 * seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.cursor.store(stamps.cursor, std::memory_order_relaxed);
+        slot.decoded.store(stamps.decoded, std::memory_order_relaxed);
+        slot.staged.store(stamps.staged, std::memory_order_relaxed);
+        slot.version.store(2 * seq + 2, std::memory_order_release);
+    }
+
+    bool get(uint64_t seq, LatencyStamps& stamps) const {
+        const Slot& slot = slots_[seq & mask_];
+        if (slot.version.load(std::memory_order_acquire) != 2 * seq + 2) return false;
+        stamps.cursor = slot.cursor.load(std::memory_order_relaxed);
+        stamps.decoded = slot.decoded.load(std::memory_order_relaxed);
+        stamps.staged = slot.staged.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.version.load(std::memory_order_relaxed) == 2 * seq + 2;
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> version{0};
+        std::atomic<uint64_t> cursor{0};
+        std::atomic<uint64_t> decoded{0};
+        std::atomic<uint64_t> staged{0};
+    };
+
+    size_t mask_;
+    std::vector<Slot> slots_;
+};
+
+// Producer side, the parser thread stamps its stages and hands them to the channel once the
+// message has a sequence
+class LatencyProbe {
+public:
+    // Start stamping messages published into a queue of this size. Replaced channels are kept
+    // alive, a consumer may still be looking at one.
+    static void track(size_t queueSize) {
+        channel_.store(&channels_.emplace_back(queueSize), std::memory_order_release);
+    }
+
+    static const LatencyChannel* channel() { return channel_.load(std::memory_order_acquire); }
+
+    static void cursor() { pending_.cursor = TscClock::now(); }
+    static void decoded() { pending_.decoded = TscClock::now(); }
+
+    static void staged(uint64_t seq) {
+        pending_.staged = TscClock::now();
+        if (LatencyChannel* channel = channel_.load(std::memory_order_relaxed)) channel->put(seq, pending_);
+    }
+
+private:
+    inline static std::deque<LatencyChannel> channels_;
+    inline static std::atomic<LatencyChannel*> channel_{nullptr};
+    inline static thread_local LatencyStamps pending_;
+};
+
+struct LatencySummary {
+    char     type;
+    uint64_t count;
+    uint64_t p50Ns;
+    uint64_t p99Ns;
+    uint64_t p999Ns;
+    uint64_t maxNs;
+};
+
+// Histograms of one consumer, one per message type and stage. Owned by LatencyStats so they
+// outlive the consumer thread and can still be dumped at exit.
+class ConsumerLatency {
+public:
+    explicit ConsumerLatency(std::string name) : name_(std::move(name)) {}
+
+    const std::string& name() const { return name_; }
+    uint64_t missing() const { return missing_.load(std::memory_order_relaxed); }
+
+    // Consumer thread only: the message at seq was read
+    void received(uint64_t seq, uint8_t type) {
+        receivedTsc_ = TscClock::now();
+        type_ = type;
+        const LatencyChannel* channel = LatencyProbe::channel();
+        valid_ = channel && channel->get(seq, stamps_);
+        if (!valid_) missing_.store(missing_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Consumer thread only: done with the message passed to the last received()
+    void handled() {
+        if (!valid_) return;
+        valid_ = false;
+
+        const uint64_t now = TscClock::now();
+        PerType& t = histograms(type_);
+        record(t, LatencyStage::Decode, stamps_.cursor, stamps_.decoded);
+        record(t, LatencyStage::Publish, stamps_.decoded, stamps_.staged);
+        record(t, LatencyStage::Queue, stamps_.staged, receivedTsc_);
+        record(t, LatencyStage::Handle, receivedTsc_, now);
+        record(t, LatencyStage::Total, stamps_.cursor, now);
+    }
+
+    // Lock-free, callable from any thread while the consumer runs
+    std::vector<LatencySummary> snapshot(LatencyStage stage) const {
+        std::vector<LatencySummary> out;
+        for (size_t type = 0; type < types_.size(); ++type) {
+            const PerType* t = types_[type].load(std::memory_order_acquire);
+            if (!t) continue;
+
+            const LatencyHistogram& h = (*t)[static_cast<size_t>(stage)];
+            out.push_back({static_cast<char>(type), h.count(), TscClock::toNs(h.percentile(0.5)),
+                           TscClock::toNs(h.percentile(0.99)), TscClock::toNs(h.percentile(0.999)),
+                           TscClock::toNs(h.max())});
+        }
+        return out;
+    }
+
+    void dump(std::ostream& os) const {
+        os << "latency " << name_ << " (ns, " << missing() << " messages without stamps)\n";
+        os << std::setw(8) << "stage" << std::setw(6) << "type" << std::setw(12) << "count"
+           << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "p99.9"
+           << std::setw(12) << "max" << '\n';
+        for (size_t s = 0; s < static_cast<size_t>(LatencyStage::Count); ++s) {
+            for (const LatencySummary& row : snapshot(static_cast<LatencyStage>(s))) {
+                os << std::setw(8) << latencyStageName(static_cast<LatencyStage>(s)) << std::setw(6) << row.type
+                   << std::setw(12) << row.count << std::setw(10) << row.p50Ns << std::setw(10) << row.p99Ns
+                   << std::setw(10) << row.p999Ns << std::setw(12) << row.maxNs << '\n';
+            }
+        }
+    }
+
+private:
+    using PerType = std::array<LatencyHistogram, static_cast<size_t>(LatencyStage::Count)>;
+
+    std::string name_;
+    std::array<std::atomic<PerType*>, 256> types_{};
+    std::deque<PerType> storage_;
+    std::atomic<uint64_t> missing_{0};
+
+    // Consumer thread state between received() and handled()
+    LatencyStamps stamps_;
+    uint64_t receivedTsc_ = 0;
+    uint8_t type_ = 0;
+    bool valid_ = false;
+
+    // A type's histograms are allocated the first time the consumer sees it
+    PerType& histograms(uint8_t type) {
+        PerType* t = types_[type].load(std::memory_order_relaxed);
+        [[unlikely]] if (!t) {
+            t = &storage_.emplace_back();
+            types_[type].store(t, std::memory_order_release);
+        }
+        return *t;
+    }
+
+    static void record(PerType& t, LatencyStage stage, uint64_t from, uint64_t to) {
+        t[static_cast<size_t>(stage)].record(to > from ? to - from : 0);
+    }
+};
+
+// Registry of every consumer's histograms, dumped to stderr at exit
+class LatencyStats {
+public:
+    static ConsumerLatency& consumer(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex());
+        if (consumers().empty()) std::atexit([] { dump(std::cerr); });
+        TscClock::calibrate();
+        return consumers().emplace_back(name);
+    }
+
+    static void dump(std::ostream& os) {
+        std::lock_guard<std::mutex> lock(mutex());
+        for (const ConsumerLatency& c : consumers()) c.dump(os);
+    }
+
+    template <typename Fn>
+    static void forEach(Fn&& fn) {
+        std::lock_guard<std::mutex> lock(mutex());
+        for (const ConsumerLatency& c : consumers()) fn(c);
+    }
+
+private:
+    // Function statics so the registry is still alive when the atexit dump runs
+    static std::deque<ConsumerLatency>& consumers() {
+        static std::deque<ConsumerLatency>* list = new std::deque<ConsumerLatency>();
+        return *list;
+    }
+
+    static std::mutex& mutex() {
+        static std::mutex* m = new std::mutex();
+        return *m;
+    }
+};
+
+#endif
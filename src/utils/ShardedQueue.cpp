@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "SpmcRingBuffer.cpp"
+
+// Maps a stock locate to a shard in [0, shards)
+using PartitionFn = size_t(*)(uint16_t locate, size_t shards);
+
+inline size_t moduloPartition(uint16_t locate, size_t shards) {
+    return locate % shards;
+}
+
+// Locate 0 carries the market wide messages (system events, MWCB)
+constexpr uint16_t MARKET_WIDE_LOCATE = 0;
+
+// K independent SPMC queues, each message goes to the queue that owns its stock locate
+// and market wide messages go to all of them. Consumers attach to the shard they own.
+class ShardedQueue {
+public:
+    ShardedQueue(size_t shards, size_t shardSize, PartitionFn partition = &moduloPartition,
+                 QueueMode mode = QueueMode::Overwrite) {
+        if (shards == 0 || shards > UINT16_MAX) {
+            throw std::invalid_argument("Shard count must be in [1, 65535]");
+        }
+        shards_.reserve(shards);
+        for (size_t i = 0; i < shards; ++i) {
+            shards_.push_back(std::make_unique<SPMC_Queue>(shardSize, mode));
+        }
+        route_ = std::make_unique<std::array<uint16_t, 65536>>();
+        staged_.assign(shards, 0);
+        dirty_.reserve(shards);
+        setPartition(partition);
+    }
+
+    // The partition function is evaluated once per locate into a routing table,
+    // so the hot path is one table load regardless of how expensive it is
+    void setPartition(PartitionFn partition) {
+        for (size_t locate = 0; locate < route_->size(); ++locate) {
+            (*route_)[locate] = static_cast<uint16_t>(partition(static_cast<uint16_t>(locate), shards_.size()) % shards_.size());
+        }
+    }
+
+    // Move a single locate to another shard, e.g. to split up hot symbols
+    void assign(uint16_t locate, size_t shard) {
+        (*route_)[locate] = static_cast<uint16_t>(shard % shards_.size());
+    }
+
+    template <typename Fn>
+    void Write(uint16_t locate, PayloadSize size, Fn&& write) {
+        [[unlikely]] if (locate == MARKET_WIDE_LOCATE) {
+            for (auto& shard : shards_) shard->Write(size, write);
+            return;
+        }
+        shards_[(*route_)[locate]]->Write(size, write);
+    }
+
+    // Stage without publishing, Publish makes everything staged on every shard visible
+    template <typename Fn>
+    void Stage(uint16_t locate, PayloadSize size, Fn&& write) {
+        [[unlikely]] if (locate == MARKET_WIDE_LOCATE) {
+            for (size_t i = 0; i < shards_.size(); ++i) {
+                markStaged(i);
+                shards_[i]->Stage(size, write);
+            }
+            return;
+        }
+        const size_t i = (*route_)[locate];
+        markStaged(i);
+        shards_[i]->Stage(size, write);
+    }
+
+    // Only the shards Stage touched since the last Publish, so a flush costs one Commit per
+    // shard with something to show rather than one per shard
+    void Publish() {
+        for (uint16_t i : dirty_) {
+            staged_[i] = 0;
+            shards_[i]->Publish();
+        }
+        dirty_.clear();
+    }
+
+    SPMC_Queue& shard(size_t i) { return *shards_[i]; }
+
+    size_t shardOf(uint16_t locate) const { return (*route_)[locate]; }
+
+    size_t shardCount() const { return shards_.size(); }
+
+private:
+    std::vector<std::unique_ptr<SPMC_Queue>> shards_;
+    std::unique_ptr<std::array<uint16_t, 65536>> route_;
+    std::vector<uint8_t> staged_;       // per shard, set while it is in dirty_
+    std::vector<uint16_t> dirty_;       // shards with staged messages, in first staged order
+
+    void markStaged(size_t i) {
+        if (staged_[i]) return;
+        staged_[i] = 1;
+        dirty_.push_back(static_cast<uint16_t>(i));
+    }
+};
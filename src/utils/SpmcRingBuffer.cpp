@@ -1,3 +1,5 @@
+#pragma once
+
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
@@ -10,6 +12,24 @@
 #include <atomic>
 #include <memory>
 #include <new>
+#include <span>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <immintrin.h>
+#include <x86intrin.h>
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 template <size_t N>
 concept PowerOfTwo = (N & (N - 1)) == 0 && N > 0;
@@ -70,80 +90,717 @@ struct alignas(64) ConsumerState {
     size_t readIdx = 0;
 };  
 
-using BlockVersion = uint32_t;
+using BlockVersion = uint64_t;
 using PayloadSize = uint32_t;
-using WriteCallback = std::function<void(uint8_t* data)>;
+
+// Alignment of everything that can live in shared memory. Fixed rather than
+// std::hardware_destructive_interference_size, which may differ between the compilers
+// (or -mtune) that built the producer and a consumer attaching to the same mapping.
+inline constexpr size_t SHARED_CACHE_LINE = 64;
 
 struct Block
 {
-    // Local block versions reduce contention for the queue
+    // Encodes the sequence held by the block: 2s+1 while s is being written, 2s+2 once it is done, 0 = never written
     std::atomic<BlockVersion> version{0};
     // Size of the data
     std::atomic<PayloadSize> payloadSize{0};
     // 64 byte payload
-    alignas(std::hardware_destructive_interference_size) uint8_t payload[64]{};
+    alignas(SHARED_CACHE_LINE) uint8_t payload[64]{};
 };
 
 struct Header
 {
-    // Block count
-    alignas(std::hardware_destructive_interference_size) std::atomic<uint64_t> writeIdx {0};
+    // Next sequence the producer will write
+    alignas(SHARED_CACHE_LINE) std::atomic<uint64_t> writeIdx {0};
+    // Readers using WaitStrategy::Blocking, the producer skips wakeups entirely while this is 0
+    std::atomic<uint32_t> blockingReaders {0};
+
+    // Futex word blocking readers sleep on. The low bit says someone is (about to be) asleep and
+    // the rest counts wakeups, so a reader that dies asleep costs the producer one extra wake at most.
+    static constexpr uint32_t SLEEPING = 1;
+    alignas(SHARED_CACHE_LINE) std::atomic<uint32_t> signal {0};
+};
+
+// First cache lines of every queue, in shared memory they tell an attaching process what it maps
+struct alignas(SHARED_CACHE_LINE) SharedHeader
+{
+    static constexpr char MAGIC[8] = "EXCSPMC";
+    // Bump whenever Header, ConsumerSlot or Block change layout
+    static constexpr uint32_t LAYOUT_VERSION = 1;
+
+    static constexpr uint32_t Initialising = 0;
+    static constexpr uint32_t Live = 1;
+    static constexpr uint32_t Closed = 2;
+
+    char magic[8];
+    uint32_t layoutVersion;
+    uint32_t blockSize;
+    uint64_t size;
+    uint32_t maxConsumers;
+    uint8_t mode;
+    std::atomic<uint32_t> state {Initialising};
+    std::atomic<int32_t> producerPid {0};
+    // CLOCK_MONOTONIC of the producer's last heartbeat() in ns
+    alignas(SHARED_CACHE_LINE) std::atomic<uint64_t> heartbeatNs {0};
 };
 
+inline uint64_t monotonicNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+// Not FUTEX_PRIVATE_FLAG, so the same word works when the queue lives in shared memory
+inline void futexWait(std::atomic<uint32_t>& word, uint32_t expected, long timeoutNs) {
+    timespec timeout{timeoutNs / 1'000'000'000, timeoutNs % 1'000'000'000};
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+inline void futexWakeAll(std::atomic<uint32_t>& word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+// How a reader waits for the producer when the queue is empty
+enum class WaitStrategy : uint8_t {
+    BusySpin,   // lowest latency, burns a core
+    SpinYield,  // spin briefly, then give the core back between polls
+    Blocking    // spin briefly, then sleep on a futex until the producer publishes
+};
+
+// Overwrite never waits and slow readers get lapped, Lossless makes the producer wait for
+// the slowest registered reader so nothing is ever dropped
+enum class QueueMode : uint8_t {
+    Overwrite,
+    Lossless
+};
+
+// A registered reader's sequence, one per cache line so readers never share a line
+struct alignas(SHARED_CACHE_LINE) ConsumerSlot
+{
+    static constexpr uint32_t Free = 0;
+    static constexpr uint32_t Claimed = 1;
+    static constexpr uint32_t Active = 2;
+
+    std::atomic<uint32_t> state{Free};
+    // Owning process, so a gated producer can free the slot of a reader that died
+    std::atomic<int32_t> pid{0};
+    // Next sequence the reader will read, everything below it may be overwritten
+    std::atomic<uint64_t> seq{0};
+};
+
+// One message copied out of an SPMC_Queue by SPMC_Reader::ReadBatch
+struct QueueMessage
+{
+    PayloadSize size;
+    alignas(8) uint8_t payload[64];
+};
+
+enum class ReadStatus : uint8_t {
+    Ok,         // data holds the message at the requested sequence
+    NotReady,   // the producer has not published that sequence yet
+    Overrun     // the producer lapped the reader, the sequence is gone
+};
 
+// Broadcast queue: every reader sees every message and keeps its own sequence, reads never
+// touch shared state. A block's version says exactly which sequence it holds, so a reader
+// that fell more than size() behind finds out instead of silently reading newer data.
+// In Lossless mode the producer is gated on the slowest reader, readers hold a ConsumerSlot.
+//
+// Everything the protocol touches (SharedHeader, Header, reader slots, blocks) lives in one
+// mapping: anonymous for an in-process queue, or a POSIX shared memory object / memfd that other
+// processes attach to. The protocol is the same either way.
 class SPMC_Queue {
 public:
-    SPMC_Queue(size_t size): size_(size), blocks_(std::make_unique<Block[]>(size)) {}
-    ~SPMC_Queue() = default;  
-
-    void Write(PayloadSize size, WriteCallback write){
-        // the next block index to write to
-        uint64_t blockIndex = header_.writeIdx.fetch_add(1, std::memory_order_acquire) % size_;
-        Block &block = blocks_[blockIndex];
-
-        BlockVersion currentVersion = block.version.load(std::memory_order_acquire) + 1;
-        // If the block has been written to before, it has an odd version
-        // we need to make its version even before writing begins to indicate that writing is in progress
-        if (block.version.load(std::memory_order_acquire) % 2 == 1){
-            // make the version even
-            block.version.store(currentVersion, std::memory_order_release);
-            // store the newVersion used for after the writing is done
-            currentVersion++;
-        }
-        // store the size
-        block.payloadSize.store(size, std::memory_order_release);
-        // perform write using the callback function
-        write(block.payload);
-        // store the new odd version
-        block.version.store(currentVersion, std::memory_order_release);
-    }
-
-    bool Read (uint64_t blockIndex, uint8_t* data, PayloadSize& size) const {
-        // Block
-        Block &block = blocks_[blockIndex];
-        // Block version
-        BlockVersion version = block.version.load(std::memory_order_acquire);
-        // Read when version is odd
-        if(version % 2 == 1){
-            // Size of the data
-            size = block.payloadSize.load(std::memory_order_acquire);
-            // Perform the read
-            std::memcpy(data, block.payload, size);
-            // Indicate that a read has occurred by adding a 2 to the version
-            // However do not block subsequent reads
-            block.version.store(version + 2, std::memory_order_release);
-            return true;
+    static constexpr size_t DEFAULT_MAX_CONSUMERS = 16;
+    // TSC ticks between heartbeats from the publish path, a few ms on current parts
+    static constexpr uint64_t HEARTBEAT_TICKS = 1ull << 24;
+
+    // In-process queue
+    SPMC_Queue(size_t size, QueueMode mode = QueueMode::Overwrite, size_t maxConsumers = DEFAULT_MAX_CONSUMERS) {
+        create(-1, size, mode, maxConsumers);
+    }
+
+    SPMC_Queue(const SPMC_Queue& other) = delete;
+    SPMC_Queue& operator=(const SPMC_Queue& other) = delete;
+
+    ~SPMC_Queue() {
+        if (owner_) {
+            info_->state.store(SharedHeader::Closed, std::memory_order_release);
+            if (!shmName_.empty()) shm_unlink(shmName_.c_str());
+        }
+        munmap(mapping_, mappingSize_);
+        if (fd_ != -1) close(fd_);
+    }
+
+    // Producer side: create the named shared memory object (e.g. "/excelsior.itch") and own it.
+    // A stale object of the same name, left by a producer that died, is replaced. Throws if the
+    // producer that owns it is still running.
+    static std::unique_ptr<SPMC_Queue> createShared(const std::string& name, size_t size,
+                                                    QueueMode mode = QueueMode::Overwrite,
+                                                    size_t maxConsumers = DEFAULT_MAX_CONSUMERS) {
+        unlinkStale(name);
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+        if (fd == -1) {
+            throw std::runtime_error("Failed to create shared memory queue " + name);
+        }
+        std::unique_ptr<SPMC_Queue> queue(new SPMC_Queue());
+        queue->shmName_ = name;
+        try {
+            queue->create(fd, size, mode, maxConsumers);
+        } catch (...) {
+            // Not owned yet, so the destructor leaves the name alone
+            shm_unlink(name.c_str());
+            throw;
+        }
+        return queue;
+    }
+
+    // Producer side: anonymous memfd backing, hand fd() to the consumers (fork, SCM_RIGHTS)
+    static std::unique_ptr<SPMC_Queue> createMemfd(size_t size, QueueMode mode = QueueMode::Overwrite,
+                                                   size_t maxConsumers = DEFAULT_MAX_CONSUMERS) {
+        int fd = memfd_create("excelsior-spmc", MFD_CLOEXEC);
+        if (fd == -1) {
+            throw std::runtime_error("Failed to create memfd queue");
+        }
+        std::unique_ptr<SPMC_Queue> queue(new SPMC_Queue());
+        queue->create(fd, size, mode, maxConsumers);
+        return queue;
+    }
+
+    // Consumer side: map a queue another process created, by name or by memfd
+    static std::unique_ptr<SPMC_Queue> attachShared(const std::string& name) {
+        int fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd == -1) {
+            throw std::runtime_error("No shared memory queue named " + name);
         }
-        return false;
+        std::unique_ptr<SPMC_Queue> queue(new SPMC_Queue());
+        queue->attach(fd);
+        return queue;
+    }
+
+    static std::unique_ptr<SPMC_Queue> attachFd(int fd) {
+        int own = dup(fd);
+        if (own == -1) {
+            throw std::runtime_error("Failed to duplicate queue fd");
+        }
+        std::unique_ptr<SPMC_Queue> queue(new SPMC_Queue());
+        queue->attach(own);
+        return queue;
+    }
+
+    // Producer only: publish one message, write fills the payload
+    template <typename Fn>
+    void Write(PayloadSize size, Fn&& write){
+        Stage(size, std::forward<Fn>(write));
+        Publish();
+    }
+
+    // Producer only: fill the next sequence without publishing it, see Publish. Returns the sequence.
+    template <typename Fn>
+    uint64_t Stage(PayloadSize size, Fn&& write){
+        const uint64_t seq = Claim(1);
+        write(Prepare(seq, size));
+        return seq;
+    }
+
+    // Producer only: publish everything staged or claimed so far with one release store
+    void Publish() {
+        Commit(claimed_);
+    }
+
+    // Producer only: reserve n consecutive sequences and return the first. Fill each one through
+    // Prepare, then Commit. Claimed sequences must be filled before the next Claim.
+    uint64_t Claim(size_t n) {
+        if (n > size_) {
+            throw std::invalid_argument("Cannot claim more blocks than the queue holds");
+        }
+        const uint64_t seq = claimed_;
+        // Only look at the reader slots once the cached minimum runs out
+        [[unlikely]] if (seq + n > gateLimit_) waitForConsumers(seq + n - 1);
+        claimed_ += n;
+        return seq;
+    }
+
+    // Producer only: start writing claimed sequence seq, returns the payload to fill
+    uint8_t* Prepare(uint64_t seq, PayloadSize size) {
+        Block &block = blocks_[seq & mask_];
+
+        // Odd version: readers of the old or the new sequence back off while the payload changes
+        block.version.store(2 * seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        block.payloadSize.store(size, std::memory_order_relaxed);
+        return block.payload;
+    }
+
+    // Producer only: publish every claimed sequence below end
+    void Commit(uint64_t end) {
+        // Checked on every commit, empty ones included, so a publishing producer never looks dead
+        [[unlikely]] if (__rdtsc() >= nextHeartbeat_) {
+            heartbeat();
+            nextHeartbeat_ = __rdtsc() + HEARTBEAT_TICKS;
+        }
+
+        // Single producer, nobody else moves the write index
+        const uint64_t published = header_->writeIdx.load(std::memory_order_relaxed);
+        if (end <= published) return;
+
+        // One fence orders every payload before the even versions, which can then be relaxed
+        std::atomic_thread_fence(std::memory_order_release);
+        for (uint64_t seq = published; seq < end; ++seq) {
+            blocks_[seq & mask_].version.store(2 * seq + 2, std::memory_order_relaxed);
+        }
+        header_->writeIdx.store(end, std::memory_order_release);
+
+        [[unlikely]] if (header_->blockingReaders.load(std::memory_order_relaxed)) wakeSleepers();
+    }
+
+    // Wait until sequence seq is published or timeoutNs passes, spurious returns are allowed.
+    // Used by SPMC_Reader::Wait for WaitStrategy::Blocking.
+    void sleepUntilPublished(uint64_t seq, long timeoutNs) {
+        // Flag the sleep before the last look at head: a publish after that look sees the flag and changes the word
+        const uint32_t signal = header_->signal.fetch_or(Header::SLEEPING, std::memory_order_seq_cst) | Header::SLEEPING;
+        if (head() <= seq) futexWait(header_->signal, signal, timeoutNs);
+    }
+
+    // Wake every sleeping reader, e.g. so they notice a shutdown flag
+    void wakeSleepers() {
+        // Pairs with the seq_cst fetch_or in sleepUntilPublished
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const uint32_t signal = header_->signal.load(std::memory_order_relaxed);
+        if (!(signal & Header::SLEEPING)) return;
+        header_->signal.store((signal + 2) & ~Header::SLEEPING, std::memory_order_release);
+        futexWakeAll(header_->signal);
+    }
+
+    void addBlockingReader() {
+        header_->blockingReaders.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void removeBlockingReader() {
+        header_->blockingReaders.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Copy out the message with sequence seq, seqlock style: the copy only counts if the
+    // version is the same before and after it
+    ReadStatus Read(uint64_t seq, uint8_t* data, PayloadSize& size) const {
+        const Block &block = blocks_[seq & mask_];
+        const BlockVersion expected = 2 * seq + 2;
+
+        BlockVersion version = block.version.load(std::memory_order_acquire);
+        if (version < expected) return ReadStatus::NotReady;
+        if (version > expected) return ReadStatus::Overrun;
+
+        size = block.payloadSize.load(std::memory_order_relaxed);
+        // A torn size can only come with a changed version, clamp so the copy stays in bounds
+        std::memcpy(data, block.payload, std::min<size_t>(size, sizeof(block.payload)));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (block.version.load(std::memory_order_relaxed) != version) return ReadStatus::Overrun;
+        return ReadStatus::Ok;
+    }
+
+    // Next sequence the producer will write
+    uint64_t head() const {
+        return header_->writeIdx.load(std::memory_order_acquire);
+    }
+
+    // Oldest sequence that has not been overwritten yet
+    uint64_t oldest() const {
+        const uint64_t h = head();
+        return h > size_ ? h - size_ : 0;
     }
 
     constexpr size_t size () const {
         return size_;
     }
 
+    QueueMode mode() const {
+        return mode_;
+    }
+
+    // Times the producer found the queue full in Lossless mode
+    uint64_t producerStalls() const {
+        return stalls_;
+    }
+
+    // Producer side: Commit already calls this every HEARTBEAT_TICKS or so. A producer that can
+    // go quiet for longer than consumers' maxSilenceNs calls it from its idle path too.
+    void heartbeat() {
+        info_->heartbeatNs.store(monotonicNs(), std::memory_order_relaxed);
+    }
+
+    // Consumer side: the producer still exists and has heartbeat within maxSilenceNs
+    bool producerAlive(uint64_t maxSilenceNs) const {
+        if (info_->state.load(std::memory_order_acquire) != SharedHeader::Live) return false;
+        const pid_t pid = info_->producerPid.load(std::memory_order_relaxed);
+        if (kill(pid, 0) == -1 && errno == ESRCH) return false;
+        return monotonicNs() - info_->heartbeatNs.load(std::memory_order_relaxed) <= maxSilenceNs;
+    }
+
+    // Backing fd for memfd and named queues, -1 in process
+    int fd() const {
+        return fd_;
+    }
+
+    // Claim a reader slot starting at seq, the producer will not overwrite seq until the slot moves past it.
+    // Register before the producer passes seq + size(), or join at head().
+    ConsumerSlot* registerConsumer(uint64_t seq) {
+        for (size_t i = 0; i < maxConsumers_; ++i) {
+            ConsumerSlot& slot = consumers_[i];
+            uint32_t expected = ConsumerSlot::Free;
+            if (slot.state.compare_exchange_strong(expected, ConsumerSlot::Claimed, std::memory_order_acq_rel)) {
+                slot.seq.store(seq, std::memory_order_relaxed);
+                slot.pid.store(getpid(), std::memory_order_relaxed);
+                slot.state.store(ConsumerSlot::Active, std::memory_order_release);
+                return &slot;
+            }
+        }
+        throw std::runtime_error("SPMC_Queue has no free consumer slot");
+    }
+
+    void unregisterConsumer(ConsumerSlot* slot) {
+        slot->state.store(ConsumerSlot::Free, std::memory_order_release);
+    }
+
+    // Lowest sequence any registered reader still needs, fallback if there are none
+    uint64_t minConsumerSequence(uint64_t fallback) const {
+        uint64_t min = fallback;
+        for (size_t i = 0; i < maxConsumers_; ++i) {
+            const ConsumerSlot& slot = consumers_[i];
+            if (slot.state.load(std::memory_order_acquire) != ConsumerSlot::Active) continue;
+            min = std::min(min, slot.seq.load(std::memory_order_acquire));
+        }
+        return min;
+    }
+
 private:
-    Header header_;
-    size_t size_;
-    std::unique_ptr<Block[]> blocks_;
+    SharedHeader* info_ = nullptr;
+    Header* header_ = nullptr;
+    ConsumerSlot* consumers_ = nullptr;
+    Block* blocks_ = nullptr;
+    size_t size_ = 0;
+    size_t mask_ = 0;
+    QueueMode mode_ = QueueMode::Overwrite;
+    size_t maxConsumers_ = 0;
+
+    void* mapping_ = nullptr;
+    size_t mappingSize_ = 0;
+    int fd_ = -1;
+    std::string shmName_;
+    bool owner_ = false;
+    // Producer only: next sequence to claim, and first sequence that needs another look at the reader slots
+    uint64_t claimed_ = 0;
+    uint64_t gateLimit_ = 0;
+    uint64_t stalls_ = 0;
+    uint64_t nextHeartbeat_ = 0;
+
+    void waitForConsumers(uint64_t seq) {
+        if (mode_ == QueueMode::Overwrite) {
+            gateLimit_ = UINT64_MAX;
+            return;
+        }
+
+        // Readers can only catch up on what is published
+        Commit(claimed_);
+
+        uint32_t spins = 0;
+        while (true) {
+            gateLimit_ = minConsumerSequence(seq) + size_;
+            if (seq < gateLimit_) return;
+
+            if (spins++ == 0) ++stalls_;
+            if (spins < 256) {
+                _mm_pause();
+            } else {
+                std::this_thread::yield();
+                // A reader process that died holding a slot must not stall the feed forever
+                if (spins % 1024 == 0) reapDeadConsumers();
+            }
+        }
+    }
+
+    void reapDeadConsumers() {
+        for (size_t i = 0; i < maxConsumers_; ++i) {
+            ConsumerSlot& slot = consumers_[i];
+            if (slot.state.load(std::memory_order_acquire) != ConsumerSlot::Active) continue;
+            if (kill(slot.pid.load(std::memory_order_relaxed), 0) == -1 && errno == ESRCH) {
+                slot.state.store(ConsumerSlot::Free, std::memory_order_release);
+            }
+        }
+    }
+
+    SPMC_Queue() = default;
+
+    // Unlink an existing object called name if it is left over from a producer that is gone:
+    // closed, half created, or owned by a pid that no longer exists. Anything else is in use.
+    static void unlinkStale(const std::string& name) {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd == -1) return;
+
+        bool stale = true;
+        std::string reason;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(SharedHeader)) {
+            void* p = mmap(nullptr, sizeof(SharedHeader), PROT_READ, MAP_SHARED, fd, 0);
+            if (p != MAP_FAILED) {
+                const SharedHeader* info = static_cast<const SharedHeader*>(p);
+                static constexpr char UNSET[sizeof(info->magic)] = {};
+                if (std::memcmp(info->magic, SharedHeader::MAGIC, sizeof(info->magic)) == 0) {
+                    const pid_t pid = info->producerPid.load(std::memory_order_relaxed);
+                    const bool closed = info->state.load(std::memory_order_acquire) == SharedHeader::Closed;
+                    // EPERM still means the process exists, it just belongs to someone else
+                    if (!closed && pid > 0 && (kill(pid, 0) == 0 || errno == EPERM)) {
+                        stale = false;
+                        reason = " is owned by running producer " + std::to_string(pid);
+                    }
+                } else if (std::memcmp(info->magic, UNSET, sizeof(info->magic)) != 0) {
+                    stale = false;
+                    reason = " exists and is not an SPMC_Queue";
+                }
+                munmap(p, sizeof(SharedHeader));
+            }
+        }
+        close(fd);
+
+        if (!stale) throw std::runtime_error("Shared memory queue " + name + reason);
+        shm_unlink(name.c_str());
+    }
+
+    static size_t layoutSize(size_t size, size_t maxConsumers) {
+        return sizeof(SharedHeader) + sizeof(Header) + maxConsumers * sizeof(ConsumerSlot) + size * sizeof(Block);
+    }
+
+    void bind(void* base, size_t size, size_t maxConsumers) {
+        char* p = static_cast<char*>(base);
+        info_ = reinterpret_cast<SharedHeader*>(p);
+        header_ = reinterpret_cast<Header*>(p + sizeof(SharedHeader));
+        consumers_ = reinterpret_cast<ConsumerSlot*>(p + sizeof(SharedHeader) + sizeof(Header));
+        blocks_ = reinterpret_cast<Block*>(p + sizeof(SharedHeader) + sizeof(Header) + maxConsumers * sizeof(ConsumerSlot));
+        size_ = size;
+        mask_ = size - 1;
+        maxConsumers_ = maxConsumers;
+    }
+
+    // fd -1 maps anonymous memory for an in-process queue
+    void create(int fd, size_t size, QueueMode mode, size_t maxConsumers) {
+        if (size == 0 || (size & (size - 1)) != 0) {
+            if (fd != -1) close(fd);
+            throw std::invalid_argument("SPMC_Queue size must be a power of two");
+        }
+
+        fd_ = fd;
+        mappingSize_ = layoutSize(size, maxConsumers);
+        if (fd != -1 && ftruncate(fd, mappingSize_) == -1) {
+            throw std::runtime_error("Failed to size shared memory queue");
+        }
+        mapping_ = fd == -1 ? mmap(nullptr, mappingSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)
+                            : mmap(nullptr, mappingSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping_ == MAP_FAILED) {
+            mapping_ = nullptr;
+            throw std::runtime_error("Failed to map SPMC_Queue");
+        }
+        bind(mapping_, size, maxConsumers);
+
+        new (info_) SharedHeader();
+        // Claim the name before the slow part, so a second createShared sees a live owner
+        std::memcpy(info_->magic, SharedHeader::MAGIC, sizeof(info_->magic));
+        info_->producerPid.store(getpid(), std::memory_order_relaxed);
+
+        new (header_) Header();
+        for (size_t i = 0; i < maxConsumers; ++i) new (&consumers_[i]) ConsumerSlot();
+        for (size_t i = 0; i < size; ++i) new (&blocks_[i]) Block();
+
+        info_->layoutVersion = SharedHeader::LAYOUT_VERSION;
+        info_->blockSize = sizeof(Block);
+        info_->size = size;
+        info_->maxConsumers = static_cast<uint32_t>(maxConsumers);
+        info_->mode = static_cast<uint8_t>(mode);
+        info_->heartbeatNs.store(monotonicNs(), std::memory_order_relaxed);
+        mode_ = mode;
+        owner_ = true;
+        // Attaching processes only trust the layout once this is visible
+        info_->state.store(SharedHeader::Live, std::memory_order_release);
+    }
+
+    void attach(int fd) {
+        fd_ = fd;
+        struct stat st;
+        if (fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < sizeof(SharedHeader)) {
+            throw std::runtime_error("Shared memory queue is not initialised");
+        }
+
+        mappingSize_ = st.st_size;
+        mapping_ = mmap(nullptr, mappingSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping_ == MAP_FAILED) {
+            mapping_ = nullptr;
+            throw std::runtime_error("Failed to map shared memory queue");
+        }
+
+        const SharedHeader* info = static_cast<const SharedHeader*>(mapping_);
+        if (std::memcmp(info->magic, SharedHeader::MAGIC, sizeof(info->magic)) != 0) {
+            throw std::runtime_error("Not an SPMC_Queue");
+        }
+        if (info->layoutVersion != SharedHeader::LAYOUT_VERSION || info->blockSize != sizeof(Block)) {
+            throw std::runtime_error("SPMC_Queue layout version mismatch, rebuild against the producer");
+        }
+        if (info->state.load(std::memory_order_acquire) != SharedHeader::Live) {
+            throw std::runtime_error("SPMC_Queue producer is not live");
+        }
+        if (mappingSize_ < layoutSize(info->size, info->maxConsumers)) {
+            throw std::runtime_error("Shared memory queue is truncated");
+        }
+
+        bind(mapping_, info->size, info->maxConsumers);
+        mode_ = static_cast<QueueMode>(info->mode);
+    }
 };
 
+// Upper bound for a reader that runs after another stage, e.g. a ConsumerGroup
+class SequenceBarrier {
+public:
+    virtual ~SequenceBarrier() = default;
+
+    // Every sequence below the returned one may be read
+    virtual uint64_t available() const = 0;
+};
+
+// One consumer's cursor into an SPMC_Queue. On overrun it skips forward to the oldest
+// sequence that is still intact and counts the messages it lost.
+class SPMC_Reader {
+public:
+    // Spins before SpinYield yields or Blocking sleeps, and how long one sleep may last
+    static constexpr uint32_t SPIN_LIMIT = 512;
+    static constexpr long SLEEP_TIMEOUT_NS = 10'000'000;
+
+    // fromHead joins at the producer's current position instead of sequence 0
+    explicit SPMC_Reader(SPMC_Queue& queue, bool fromHead = false, WaitStrategy strategy = WaitStrategy::BusySpin)
+        : queue_(queue), strategy_(strategy), seq_(fromHead ? queue.head() : 0) {
+        if (queue.mode() == QueueMode::Lossless) {
+            slot_ = queue.registerConsumer(seq_);
+        }
+        if (strategy_ == WaitStrategy::Blocking) {
+            queue_.addBlockingReader();
+        }
+    }
+
+    SPMC_Reader(const SPMC_Reader& other) = delete;
+    SPMC_Reader& operator=(const SPMC_Reader& other) = delete;
+
+    ~SPMC_Reader() {
+        if (slot_) queue_.unregisterConsumer(slot_);
+        if (strategy_ == WaitStrategy::Blocking) queue_.removeBlockingReader();
+    }
+
+    // Only read what barrier says the earlier stage has finished with, nullptr to read freely.
+    // The barrier is asked again only once the sequences it last allowed are used up.
+    void setBarrier(const SequenceBarrier* barrier) {
+        barrier_ = barrier;
+        barrierLimit_ = 0;
+    }
+
+    // Wait with this reader's strategy until the next message is published. Returns early
+    // (after about SLEEP_TIMEOUT_NS at most) so callers can check their own stop flag.
+    void Wait() {
+        for (uint32_t spins = 0; queue_.head() <= seq_ || !passesBarrier(); ++spins) {
+            if (spins < SPIN_LIMIT || strategy_ == WaitStrategy::BusySpin) {
+                _mm_pause();
+                if (spins >= SPIN_LIMIT) return;
+            } else if (strategy_ == WaitStrategy::SpinYield || queue_.head() > seq_) {
+                // Held back by the barrier, nothing to sleep on
+                std::this_thread::yield();
+                return;
+            } else {
+                ++sleeps_;
+                queue_.sleepUntilPublished(seq_, SLEEP_TIMEOUT_NS);
+                return;
+            }
+        }
+    }
+
+    ReadStatus Read(uint8_t* data, PayloadSize& size) {
+        [[unlikely]] if (barrier_ && !passesBarrier()) return ReadStatus::NotReady;
+
+        ReadStatus status = queue_.Read(seq_, data, size);
+        if (status == ReadStatus::Ok) {
+            ++seq_;
+            // Release the block to a gated producer
+            if (slot_) slot_->seq.store(seq_, std::memory_order_release);
+        } else if (status == ReadStatus::Overrun) {
+            skipLapped();
+        }
+        return status;
+    }
+
+    // Copy up to out.size() published messages into out and return the filled prefix. The
+    // producer's cursor is only reloaded once the previously seen messages are used up, and a
+    // gated producer hears about the whole batch at once. Stops early on overrun, check lastLap().
+    std::span<QueueMessage> ReadBatch(std::span<QueueMessage> out) {
+        if (seq_ >= knownHead_) knownHead_ = queue_.head();
+        uint64_t limit = knownHead_;
+        [[unlikely]] if (barrier_) {
+            passesBarrier();
+            limit = std::min(limit, barrierLimit_);
+        }
+        const size_t ready = std::min<uint64_t>(limit - std::min(seq_, limit), out.size());
+
+        size_t n = 0;
+        ReadStatus status = ReadStatus::Ok;
+        while (n < ready) {
+            status = queue_.Read(seq_ + n, out[n].payload, out[n].size);
+            if (status != ReadStatus::Ok) break;
+            ++n;
+        }
+
+        seq_ += n;
+        if (status == ReadStatus::Overrun) {
+            skipLapped();
+        } else if (n && slot_) {
+            slot_->seq.store(seq_, std::memory_order_release);
+        }
+        return out.first(n);
+    }
+
+    // Sequence of the next message this reader expects
+    uint64_t position() const { return seq_; }
+
+    // Messages published but not read yet
+    uint64_t lag() const { return queue_.head() - seq_; }
+
+    // Messages lost to overruns, in total and in the most recent one
+    uint64_t lapped() const { return lapped_; }
+    uint64_t lastLap() const { return lastLap_; }
+    uint64_t overruns() const { return overruns_; }
+
+    WaitStrategy strategy() const { return strategy_; }
+    uint64_t sleeps() const { return sleeps_; }
+
+private:
+    SPMC_Queue& queue_;
+    ConsumerSlot* slot_ = nullptr;
+    WaitStrategy strategy_;
+    uint64_t seq_;
+    uint64_t knownHead_ = 0;
+    const SequenceBarrier* barrier_ = nullptr;
+    uint64_t barrierLimit_ = 0;
+    uint64_t sleeps_ = 0;
+    uint64_t lapped_ = 0;
+    uint64_t lastLap_ = 0;
+    uint64_t overruns_ = 0;
+
+    bool passesBarrier() {
+        if (!barrier_) return true;
+        if (seq_ >= barrierLimit_) barrierLimit_ = barrier_->available();
+        return seq_ < barrierLimit_;
+    }
+
+    void skipLapped() {
+        // The block being written next is head & mask, leave it alone
+        const uint64_t resume = std::max(seq_ + 1, queue_.oldest() + 1);
+        lastLap_ = resume - seq_;
+        lapped_ += lastLap_;
+        ++overruns_;
+        seq_ = resume;
+        if (slot_) slot_->seq.store(seq_, std::memory_order_release);
+    }
+};
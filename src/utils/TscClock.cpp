@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <x86intrin.h>
+
+// Invariant TSC as a cheap monotonic clock. The tick rate is measured once against
+// steady_clock on first use, about 20ms, so call calibrate() before anything timing sensitive.
+class TscClock {
+public:
+    static uint64_t now() {
+        return __rdtsc();
+    }
+
+    static double ticksPerNs() {
+        static const double rate = measure();
+        return rate;
+    }
+
+    static void calibrate() {
+        (void)ticksPerNs();
+    }
+
+    static uint64_t toNs(uint64_t ticks) {
+        return static_cast<uint64_t>(ticks / ticksPerNs());
+    }
+
+    static uint64_t toTicks(uint64_t ns) {
+        return static_cast<uint64_t>(ns * ticksPerNs());
+    }
+
+    // Sleep through most of a long wait, then spin on the TSC for the last stretch
+    static void waitUntil(uint64_t deadline) {
+        constexpr uint64_t SPIN_NS = 200'000;
+
+        uint64_t t = now();
+        if (t >= deadline) return;
+
+        uint64_t remainingNs = toNs(deadline - t);
+        if (remainingNs > 2 * SPIN_NS) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(remainingNs - SPIN_NS));
+        }
+        while (now() < deadline) {
+            _mm_pause();
+        }
+    }
+
+private:
+    static double measure() {
+        using clock = std::chrono::steady_clock;
+
+        auto wallStart = clock::now();
+        uint64_t tscStart = now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint64_t tscEnd = now();
+        auto wallEnd = clock::now();
+
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(wallEnd - wallStart).count();
+        return static_cast<double>(tscEnd - tscStart) / static_cast<double>(ns);
+    }
+};
@@ -23,14 +23,15 @@ int main() {
         });
 
         // Reader logic
-        uint64_t readIndex = 0;
+        SPMC_Reader consumer(spmcQ, false, WaitStrategy::Blocking);
         PayloadSize size;
         std::array<uint8_t, 64> scratch;
+        LATENCY_PROBE(ConsumerLatency& latency = LatencyStats::consumer("main"));
         while (true) {
-            if (spmcQ.Read(readIndex % spmcQ.size(), scratch.data(), size)) {
-                ++readIndex;            // only after a successful read
-
+            ReadStatus status = consumer.Read(scratch.data(), size);
+            if (status == ReadStatus::Ok) {
                 const char type = static_cast<char>(scratch[0]);
+                LATENCY_PROBE(latency.received(consumer.position() - 1, scratch[0]));
 
                 switch (type) {
                     case 'A': {
@@ -57,10 +58,14 @@ int main() {
                         // std::cout << "[Unhandled] MsgType: " << type << '\n';
                         break;
                     }
+                LATENCY_PROBE(latency.handled());
                 }
 
+            else if (status == ReadStatus::Overrun) {
+                std::cerr << "Lapped by the parser, lost " << consumer.lastLap() << " messages\n";
+            }
             else {
-                std::this_thread::sleep_for(std::chrono::microseconds{50});
+                consumer.Wait();
             }
         }
 